@@ -310,9 +310,54 @@ void sg_cursor_draw_hline(sg_cursor_t * cursor, sg_size_t width);
  * This function operates on 32-bit words. It is much faster
  * than a sg_get_pixel()/sg_draw_pixel() loop.
  *
+ * If the source has fewer bits per pixel than the destination, the
+ * palette lookup table is built on each call. Use sg_cursor_expand_init()
+ * and sg_cursor_draw_cursor_expand() to build it once for many rows.
+ *
  */
 void sg_cursor_draw_cursor(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width);
 
+/*! \details Builds the lookup table that sg_cursor_draw_cursor_expand() uses
+ * to copy pixels from \a src to \a dest.
+ *
+ * @param expand A pointer to the table to build
+ * @param dest The destination bitmap (its palette and pen color select the colors)
+ * @param src The source bitmap
+ * @return Zero on success or -1 if \a src doesn't have fewer bits per pixel than \a dest
+ *
+ * The table stays valid until the palette, the pen color or the bits per
+ * pixel of either bitmap change.
+ *
+ */
+int sg_cursor_expand_init(sg_cursor_expand_t * expand, const sg_bmap_t * dest, const sg_bmap_t * src);
+
+/*! \details Same as sg_cursor_draw_cursor() for a source with fewer bits
+ * per pixel using a table from sg_cursor_expand_init().
+ *
+ * @param dest_cursor The cursor where pixels will be drawn
+ * @param src_cursor The cursor where pixels are copied from
+ * @param width The number of pixels to copy
+ * @param expand The lookup table built for the two bitmaps
+ *
+ */
+void sg_cursor_draw_cursor_expand(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, const sg_cursor_expand_t * expand);
+
+/*! \details Combines \a pattern, the pixels at \a src_cursor and the pixels at
+ * \a dest_cursor using a ternary raster operation and updates the x location
+ * of \a dest_cursor to the pixel past the end of the operation.
+ *
+ * @param dest_cursor The cursor where pixels will be drawn
+ * @param src_cursor The cursor where pixels are read from
+ * @param width The number of pixels to draw
+ * @param pattern The pattern (aligned to the destination words)
+ * @param rop The ternary raster operation (see SG_ROP3_PATTERN)
+ *
+ * The pen flags are not used. When both bitmaps have the same bits
+ * per pixel, each destination word is read and written once.
+ *
+ */
+void sg_cursor_draw_cursor_rop(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, sg_bmap_data_t pattern, u8 rop);
+
 /*! \details Draws the specified pattern in a horizontal line at \a cursor.
  *
  * @param cursor The cursor
@@ -320,16 +365,34 @@ void sg_cursor_draw_cursor(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cu
  * @param pattern The pattern to draw
  *
  * This function operates on 32-bit words and is much faster
- * than a sg_draw_pixel() loop.
+ * than a sg_draw_pixel() loop. Partial words at either end of
+ * the line are written using a single masked operation.
+ *
+ * If the pen has SG_PEN_FLAG_IS_ZERO_TRANSPARENT set, pixels that are zero
+ * in \a pattern are left unchanged.
  *
  */
 void sg_cursor_draw_pattern(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern);
 
+/*! \details Moves the cursor's x location by \a n pixels.
+ *
+ * @param cursor A pointer to the cursor
+ * @param n The number of pixels to move (negative values move to the left)
+ *
+ * This is equivalent to calling sg_cursor_inc_x() (or sg_cursor_dec_x())
+ * \a n times but takes the same amount of time for any value of \a n.
+ *
+ */
+void sg_cursor_advance(sg_cursor_t * cursor, int n);
+
 /*! \details Shifts the pixels at cursor to the right.
  *
  * @param cursor A pointer to the cursor
  * @param shift_width The number of pixels to shift
  * @param shift_distance The distance to shift \a shift_width pixels
+ *
+ * Pixels that are shifted out and not written over are cleared. The
+ * cursor is moved to the right by \a shift_distance.
  */
 void sg_cursor_shift_right(sg_cursor_t * cursor, sg_size_t shift_width, sg_size_t shift_distance);
 
@@ -338,15 +401,51 @@ void sg_cursor_shift_right(sg_cursor_t * cursor, sg_size_t shift_width, sg_size_
  * @param cursor A pointer to the cursor
  * @param shift_width The number of pixels to shift
  * @param shift_distance The distance to shift \a shift_width pixels
+ *
+ * Pixels that are shifted out and not written over are cleared. The
+ * cursor is moved to the left by \a shift_distance.
  */
 void sg_cursor_shift_left(sg_cursor_t * cursor, sg_size_t shift_width, sg_size_t shift_distance);
 
 
 
+/*! \details Finds the first non-zero pixel.
+ *
+ * @param cursor A pointer to the cursor (updated to point to the edge)
+ * @param max_distance The maximum number of pixels to search
+ * @return The number of pixels before the edge (or \a max_distance if there isn't one)
+ *
+ * The search operates on 32-bit words rather than pixels.
+ *
+ */
 sg_int_t sg_cursor_find_positive_edge(sg_cursor_t * cursor, sg_size_t max_distance);
+
+/*! \details Finds the first zero pixel.
+ *
+ * \sa sg_cursor_find_positive_edge()
+ */
 sg_int_t sg_cursor_find_negative_edge(sg_cursor_t * cursor, sg_size_t max_distance);
+
+/*! \details Finds the first pixel that is not \a current_color.
+ *
+ * \sa sg_cursor_find_positive_edge()
+ */
 sg_int_t sg_cursor_find_edge(sg_cursor_t * cursor, sg_color_t current_color, sg_size_t max_distance);
 
+/*! \details Splits a horizontal line into runs of pixels with the same color.
+ *
+ * @param cursor A pointer to the cursor (updated to point past the last pixel in \a runs)
+ * @param width The number of pixels to scan
+ * @param runs A pointer to the destination for the runs
+ * @param max_runs The number of entries available in \a runs
+ * @return The number of runs written to \a runs
+ *
+ * If \a runs fills up before \a width pixels are scanned, the cursor
+ * points to the start of the next run so the scan can be resumed.
+ *
+ */
+u32 sg_cursor_find_runs(sg_cursor_t * cursor, sg_size_t width, sg_cursor_run_t * runs, u32 max_runs);
+
 /*! @} */
 
 
@@ -384,9 +483,43 @@ void sg_draw_pixel(const sg_bmap_t * bmap, sg_point_t p);
  * The color and thickness of the line are determined
  * by the bmap->pen object.
  *
+ * If the pen has SG_PEN_FLAG_IS_ANTIALIAS set, the bitmap has 2, 4 or 8
+ * bits per pixel and the thickness is one, the line is antialiased. Each
+ * pixel the line passes near is moved toward the pen color in proportion
+ * to how much of it the line covers. This assumes the pixel values are
+ * intensities (grayscale or a palette ramp). The raster operation flags
+ * of the pen are not used for antialiased lines.
+ *
+ * If the pen has SG_PEN_FLAG_IS_DASH set, each pixel along the line's
+ * major axis uses the next bit of sg_pen_t.dash (starting with bit
+ * sg_pen_t.dash_phase at \a p1) and is only drawn if the bit is set.
+ * One pixel wide horizontal lines use the dash bits as the mask for each
+ * word of the row. Thicker horizontal and vertical dashes are filled like
+ * rectangles.
+ *
  */
 void sg_draw_line(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2);
 
+/*! \details Draws a chain of connected lines on the bitmap.
+ *
+ * @param bmap A pointer to the bmap
+ * @param points The points to connect (points[0] to points[1] and so on)
+ * @param count The number of points
+ *
+ * The color and thickness of the lines are determined
+ * by the bmap->pen object.
+ *
+ * Each pixel of the chain is drawn once, so the joints are not drawn
+ * twice when the pen uses SG_PEN_FLAG_IS_INVERT (or another raster
+ * operation that depends on the destination). If the last point is the
+ * same as the first point, the chain is closed. Lines that are thicker
+ * than one pixel are joined with a disc and the ends of an open chain
+ * use the pen's cap style. Antialiasing and dashes work the same as
+ * sg_draw_line() and the dash pattern continues from one line to the next.
+ *
+ */
+void sg_draw_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count);
+
 /*! \details Draws a quadratic bezier curve on the bitmap.
  *
  * @param bmap A pointer to the bitmap object
@@ -428,6 +561,81 @@ void sg_draw_cubic_bezier(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2,
  */
 void sg_draw_rectangle(const sg_bmap_t * bmap, const sg_region_t * region);
 
+/*! \details Draws a list of rectangles.
+ *
+ * @param bmap A pointer to the bitmap object
+ * @param regions The rectangles to draw
+ * @param count The number of rectangles
+ *
+ * This covers the same pixels as calling sg_draw_rectangle() for each
+ * region, but rectangles that overlap are merged so each pixel is drawn
+ * once. With SG_PEN_FLAG_IS_INVERT (or a raster operation where drawing a
+ * pixel twice changes it) a pixel covered by several rectangles is
+ * inverted once and the whole list is swept in one pass, which costs a
+ * scan of the list for each band of rows where the same rectangles are
+ * present. Other pens merge groups of 32 rectangles, where a pixel
+ * drawn by more than one group is written again with the same result.
+ *
+ */
+void sg_draw_rectangles(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count);
+
+/*! \details Draws a rectangle with rounded corners.
+ *
+ * @param bmap A pointer to the bitmap object
+ * @param region The rectangle
+ * @param radii The radius of each corner (zero for square corners)
+ * @param is_filled Non-zero to fill the rectangle or zero to draw its outline
+ *
+ * The color of the rectangle and the thickness of the outline
+ * are determined by the bmap->pen object. The radii are limited to
+ * half of the smaller side of the rectangle (so a radius of
+ * SG_MAX makes a pill shape).
+ *
+ * Each row is filled as a span so a rounded rectangle costs about
+ * the same as a rectangle.
+ *
+ */
+void sg_draw_round_rect(const sg_bmap_t * bmap, const sg_region_t * region, const sg_corner_radii_t * radii, int is_filled);
+
+/*! \details Draws a filled circle.
+ *
+ * @param bmap A pointer to the bitmap object
+ * @param center The center of the circle
+ * @param radius The radius of the circle
+ *
+ * The color of the circle is determined by the bmap->pen object.
+ *
+ */
+void sg_draw_circle_filled(const sg_bmap_t * bmap, sg_point_t center, sg_size_t radius);
+
+/*! \details Draws a filled convex polygon.
+ *
+ * @param bmap A pointer to the bitmap object
+ * @param points The corners of the polygon in order (either direction)
+ * @param count The number of points
+ *
+ * The color of the polygon is determined by the bmap->pen object. The
+ * filled area includes the pixels that sg_draw_polyline() draws for the
+ * polygon's edges when the pen is one pixel thick.
+ *
+ * Each row is filled as a single span between the left and right edges
+ * so the polygon must be convex. Nothing is read from the bitmap.
+ *
+ */
+void sg_draw_polygon_filled(const sg_bmap_t * bmap, const sg_point_t * points, u32 count);
+
+/*! \details Draws a filled triangle.
+ *
+ * @param bmap A pointer to the bitmap object
+ * @param p1 First corner
+ * @param p2 Second corner
+ * @param p3 Third corner
+ *
+ * This is the same as sg_draw_polygon_filled() with three points.
+ *
+ */
+void sg_draw_triangle_filled(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2, sg_point_t p3);
+
 
 /*! \details Draws an arc on the bitmap.
  *
@@ -438,6 +646,18 @@ void sg_draw_rectangle(const sg_bmap_t * bmap, const sg_region_t * region);
  * @param rotation A rotation angle that is applied to every point in the arc
  * @param corners If non-zero, corners[0] will be the top left corner and corners[1] will be the bottom right corner enclosing the curve
  *
+ * The color and thickness of the arc are determined by the bmap->pen
+ * object. Angles are in units of SG_TRIG_POINTS per revolution.
+ *
+ * If \a rotation is zero, the arc is rasterized row by row (thick arcs are
+ * filled between the inner and outer edges) so it has no gaps at any size.
+ * Rotated arcs are drawn by sampling each angle, and so are partial arcs
+ * whose radius is no larger than the pen thickness in either direction
+ * (there the row edges are too flat to split at the start and end
+ * angles). If the pen is dashed
+ * (see sg_draw_line()), the arc is drawn as a chain of short lines so
+ * the pattern follows the curve.
+ *
  */
 void sg_draw_arc(const sg_bmap_t * bmap, const sg_region_t * region, s16 start, s16 end, s16 rotation, sg_point_t * corners);
 
@@ -452,9 +672,44 @@ void sg_draw_arc(const sg_bmap_t * bmap, const sg_region_t * region, s16 start,
  * a line or a bound. If the bmap's pen color is zero, the pour
  * will act as an eraser pour rather than an ink pour.
  *
+ * Every pixel that is reached is set to the pen color (or zero when
+ * erasing); the pen's raster operation is not applied. The fill doesn't
+ * recurse. It keeps an array of 256 spans (1792 bytes) and a visited
+ * mask of 1024 bytes on the stack, so its worst case stack use is about
+ * 3 KB for any outline (see sg_draw_pour_spans()). If the bounds have
+ * no more than 8192 pixels (such as 128x64), the whole area is always
+ * filled. For larger bounds the mask isn't used and an outline that needs
+ * more than 256 spans at once (such as noise) is left partly unfilled;
+ * use sg_draw_pour_spans() with a visited mask to pour those.
+ *
  */
 void sg_draw_pour(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region);
 
+/*! \details Pours a color on the bitmap using caller provided memory.
+ *
+ * @param bmap A pointer to the bitmap object
+ * @param p The point where the pour should start.
+ * @param bounds The bounds for the pour.
+ * @param spans Memory for the stack of spans waiting to be checked
+ * @param max_spans The number of entries in \a spans
+ * @param visited Zero or SG_POUR_VISITED_WORDS(width, height) words for the bounds (clipped to the bitmap)
+ * @return The number of spans that didn't fit on the stack (always zero if \a visited is given)
+ *
+ * This works the same as sg_draw_pour() but the caller decides how
+ * much memory the fill can use. Rows are scanned and filled a word at a time.
+ *
+ * Simple shapes need only a few entries but each concave turn in the
+ * outline can add one and noise can need thousands. If the stack is
+ * full, the span is dropped. With \a visited, filled pixels are also
+ * marked in the mask, and once the stack is empty the rows next to the
+ * marked pixels of the rows with dropped spans are scanned again (a word
+ * at a time) so the pour always finishes. A smaller stack means more
+ * rescans. Without \a visited, the area past a dropped span is left
+ * unfilled and counted in the return value.
+ *
+ */
+int sg_draw_pour_spans(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, sg_pour_span_t * spans, u32 max_spans, u32 * visited);
+
 
 /*! \details Draws a pattern in the specified area of the bitmap.
  *
@@ -494,6 +749,47 @@ void sg_draw_bitmap(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg_bma
  */
 void sg_draw_sub_bitmap(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg_bmap_t * bmap_src, const sg_region_t * region_src);
 
+/*! \details Draws a subset of the source bitmap on the destination bitmap
+ * using a ternary raster operation.
+ *
+ * @param bmap_dest The destination bitmap
+ * @param p_dest The point in the destination bitmap to start setting pixels
+ * @param bmap_src The source bitmap
+ * @param region_src The region of the source bitmap to draw
+ * @param rop The ternary raster operation (see SG_ROP3_PATTERN)
+ *
+ * The pattern is the pen color of \a bmap_dest. The pattern, source and
+ * destination are combined in a single pass over the destination. For example,
+ * `SG_ROP3_SOURCE ^ SG_ROP3_DEST` inverts the destination where source pixels are set
+ * and `(SG_ROP3_PATTERN & SG_ROP3_SOURCE) | (SG_ROP3_DEST & ~SG_ROP3_SOURCE)`
+ * stamps the pen color where the source bits are set.
+ *
+ */
+void sg_draw_sub_bitmap_rop(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg_bmap_t * bmap_src, const sg_region_t * region_src, u8 rop);
+
+/*! \details Draws a bitmap that was rendered at a larger scale as antialiased
+ * pixels.
+ *
+ * @param bmap_dest The destination bitmap
+ * @param p_dest The point in the destination bitmap for the top left corner
+ * @param bmap_src The scratch bitmap that holds the larger rendering
+ * @param factor The scale of the scratch bitmap (2 or 4)
+ * @return Zero on success or -1 if the factor or the source bits per pixel aren't supported
+ *
+ * Any of the drawing functions can be antialiased this way. First draw them
+ * on a scratch bitmap (usually 1 bit per pixel) that is \a factor times wider
+ * and taller than the destination area. Then call this function. Each
+ * \a factor x \a factor block of the scratch bitmap becomes one destination
+ * pixel. That pixel is blended toward the pen color of \a bmap_dest by the
+ * fraction of the block's pixels that aren't zero. Pixels in empty blocks are
+ * not changed.
+ *
+ * The source can have up to 8 bits per pixel. Blocks that don't fit completely
+ * in the source are ignored.
+ *
+ */
+int sg_draw_downsample(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg_bmap_t * bmap_src, u8 factor);
+
 /*! @} */
 
 
@@ -508,9 +804,59 @@ void sg_draw_sub_bitmap(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg
  * @param path The path to draw
  * @param map The map that describes how the path will be drawn on the bitmap
  *
+ * Lines and curves that follow each other are drawn as one stroke so a
+ * dashed pen (see sg_draw_line()) continues its pattern until the next
+ * move or pour.
+ *
+ * A SG_VECTOR_PATH_FILL entry fills the area enclosed by the outlines
+ * between it and the previous fill (or the start of the icon). Each outline
+ * starts with a move and is closed automatically. Overlapping outlines are
+ * combined with the non-zero winding rule or, if
+ * SG_VECTOR_PATH_FLAG_IS_FILL_ODD_EVEN is set in the fill's flags, the
+ * even-odd rule. The interior is drawn with the pen as horizontal spans. Unlike a
+ * pour, it doesn't read the bitmap, so gaps in an outline don't let the fill
+ * leak out.
+ *
+ * If the pen has SG_PEN_FLAG_IS_ANTIALIAS set and the bitmap has 2, 4 or 8
+ * bits per pixel, each pixel is instead blended toward the pen color by the
+ * fraction of its area that is inside the outlines. For outlines that don't
+ * cross themselves or each other, this is within one intensity level of the
+ * exact area at 8 bits per pixel. Where outlines cross or overlap inside a
+ * pixel, their signed areas are summed before the fill rule is applied, so
+ * that pixel's coverage is only an approximation.
+ *
  */
 void sg_vector_draw_path(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map);
 
+/*! \details Draws several vector paths on the bitmap one strip of rows at a time.
+ *
+ * @param bmap The bitmap to draw on
+ * @param items The paths to draw (in order from back to front)
+ * @param count The number of items
+ *
+ * The result is the same as calling sg_vector_draw_path() for each item
+ * (with the item's pen) but the bitmap is split into strips that are
+ * 32 pixels tall and as wide as the bitmap. Each item is assigned to the
+ * strips that its map region (grown for rotation and pen thickness)
+ * touches. Every strip then draws its items to completion before moving
+ * on, so each part of the bitmap is only brought into the cache once and
+ * strips with no items are skipped. An item that is entirely off the bitmap
+ * is not drawn at all, so its path's region is left as it was.
+ *
+ * Each item's outlines are walked again for every strip it touches
+ * (fills only keep the edges that cross the strip and strokes are clipped
+ * to it), so an item that spans N strips is flattened N times. This pays
+ * off when the data cache is smaller than the bitmap (such as a 16 KB
+ * cache and a 800x480 display). If the cache holds the whole bitmap,
+ * drawing the items with sg_vector_draw_path() is faster.
+ *
+ * A pour reads pixels outside of its own strip, so if any item has a
+ * SG_VECTOR_PATH_POUR entry, the items are drawn one after the other on the
+ * whole bitmap instead.
+ *
+ */
+void sg_vector_draw_scene(sg_bmap_t * bmap, const sg_vector_scene_item_t * items, u32 count);
+
 
 /*! @} */
 
@@ -628,6 +974,23 @@ typedef struct MCU_PACK {
 			sg_region_t region
 			);
 
+	//entries below were added in 4.0 (sg_bmap_t and sg_pen_t also changed size in 4.0 so the ABI is not compatible with 3.x)
+	int (*cursor_expand_init)(sg_cursor_expand_t * expand, const sg_bmap_t * dest, const sg_bmap_t * src);
+	void (*cursor_draw_cursor_expand)(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, const sg_cursor_expand_t * expand);
+	u32 (*cursor_find_runs)(sg_cursor_t * cursor, sg_size_t width, sg_cursor_run_t * runs, u32 max_runs);
+	void (*cursor_advance)(sg_cursor_t * cursor, int n);
+	void (*cursor_draw_cursor_rop)(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, sg_bmap_data_t pattern, u8 rop);
+	void (*draw_sub_bitmap_rop)(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg_bmap_t * bmap_src, const sg_region_t * region_src, u8 rop);
+	void (*draw_polyline)(const sg_bmap_t * bmap, const sg_point_t * points, u32 count);
+	void (*draw_round_rect)(const sg_bmap_t * bmap, const sg_region_t * region, const sg_corner_radii_t * radii, int is_filled);
+	void (*draw_circle_filled)(const sg_bmap_t * bmap, sg_point_t center, sg_size_t radius);
+	void (*draw_polygon_filled)(const sg_bmap_t * bmap, const sg_point_t * points, u32 count);
+	void (*draw_triangle_filled)(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2, sg_point_t p3);
+	void (*draw_rectangles)(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count);
+	int (*draw_pour_spans)(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, sg_pour_span_t * spans, u32 max_spans, u32 * visited);
+	int (*draw_downsample)(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg_bmap_t * bmap_src, u8 factor);
+	void (*vector_draw_scene)(sg_bmap_t * bmap, const sg_vector_scene_item_t * items, u32 count);
+
 } sg_api_t;
 
 extern const sg_api_t sg_api;
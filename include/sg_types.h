@@ -20,8 +20,8 @@ typedef int64_t s64;
 
 #include <sys/types.h>
 
-#define SG_STR_VERSION "3.1"
-#define SG_VERSION 0x0301
+#define SG_STR_VERSION "4.0"
+#define SG_VERSION 0x0400
 
 #define SG_MAX (32767)
 #define SG_MIN (-32767)
@@ -101,7 +101,54 @@ enum {
 	SG_PEN_FLAG_IS_ERASE /*! Erases the colors that are set in the pen (logical AND of inverse color) */ = (1<<2),
 	SG_PEN_FLAG_IS_AND /*! Alias for SG_PEN_FLAG_IS_ERASE */  = SG_PEN_FLAG_IS_ERASE,
 	SG_PEN_FLAG_IS_FILL /*! When drawing vector icons, this flag enables fill points specified by the icon */ = (1<<3),
-	SG_PEN_FLAG_IS_ZERO_TRANSPARENT /*! Don't draw anything if color value is zero */ = (1<<4)
+	SG_PEN_FLAG_IS_ZERO_TRANSPARENT /*! Don't draw anything if color value is zero */ = (1<<4),
+	SG_PEN_FLAG_IS_ROP /*! Draws using the raster operation in sg_pen_t.rop (takes priority over the flags above) */ = (1<<5),
+	SG_PEN_FLAG_IS_CAP_SQUARE /*! Lines thicker than one pixel are extended by half the thickness at each end (default is a butt cap) */ = (1<<6),
+	SG_PEN_FLAG_IS_CAP_ROUND /*! Lines thicker than one pixel have rounded ends */ = (1<<7),
+	SG_PEN_FLAG_IS_ANTIALIAS /*! Single pixel wide lines and vector path fills on 2, 4 and 8 bit bitmaps are antialiased (pixel values are blended toward the pen color) */ = (1<<8),
+	SG_PEN_FLAG_IS_DASH /*! Lines, arcs and vector paths are stroked with the pattern in sg_pen_t.dash */ = (1<<9)
+};
+
+/*! \brief Raster Operations
+ * \details Binary raster operations that combine the pen (or source) bits
+ * with the destination bits. Bit ((pattern << 1) | dest) of each code
+ * is the result for that combination of input bits.
+ *
+ * \sa SG_PEN_FLAG_IS_ROP
+ */
+enum sg_rop {
+	SG_ROP_CLEAR /*! 0 */ = 0x0,
+	SG_ROP_NOR /*! ~(pattern | dest) */ = 0x1,
+	SG_ROP_AND_INVERTED /*! ~pattern & dest (same as SG_PEN_FLAG_IS_ERASE) */ = 0x2,
+	SG_ROP_COPY_INVERTED /*! ~pattern */ = 0x3,
+	SG_ROP_AND_REVERSE /*! pattern & ~dest */ = 0x4,
+	SG_ROP_INVERT /*! ~dest */ = 0x5,
+	SG_ROP_XOR /*! pattern ^ dest (same as SG_PEN_FLAG_IS_INVERT) */ = 0x6,
+	SG_ROP_NAND /*! ~(pattern & dest) */ = 0x7,
+	SG_ROP_AND /*! pattern & dest */ = 0x8,
+	SG_ROP_EQUIV /*! ~(pattern ^ dest) */ = 0x9,
+	SG_ROP_NOOP /*! dest */ = 0xa,
+	SG_ROP_OR_INVERTED /*! ~pattern | dest */ = 0xb,
+	SG_ROP_COPY /*! pattern (same as SG_PEN_FLAG_IS_SOLID) */ = 0xc,
+	SG_ROP_OR_REVERSE /*! pattern | ~dest */ = 0xd,
+	SG_ROP_OR /*! pattern | dest (same as SG_PEN_FLAG_IS_BLEND) */ = 0xe,
+	SG_ROP_SET /*! all bits set */ = 0xf
+};
+
+/*! \brief Ternary Raster Operations
+ * \details Ternary raster operations combine a pattern, a source and the
+ * destination. Bit ((pattern << 2) | (source << 1) | dest) of the code
+ * is the result for that combination of input bits. Codes are built by
+ * combining the values below with bitwise operators. For example,
+ * `(SG_ROP3_SOURCE & SG_ROP3_PATTERN) | (SG_ROP3_DEST & ~SG_ROP3_PATTERN)`
+ * copies the source through the pattern.
+ *
+ * \sa sg_draw_sub_bitmap_rop()
+ */
+enum sg_rop3 {
+	SG_ROP3_PATTERN /*! The pattern bits */ = 0xf0,
+	SG_ROP3_SOURCE /*! The source bits */ = 0xcc,
+	SG_ROP3_DEST /*! The destination bits */ = 0xaa
 };
 
 #define SG_PEN_FLAG_NOT_SOLID_MASK (SG_PEN_FLAG_IS_BLEND|SG_PEN_FLAG_IS_INVERT|SG_PEN_FLAG_IS_ERASE)
@@ -112,15 +159,26 @@ enum {
 typedef struct MCU_PACK {
 	u16 o_flags /*! Flags (SG_PEN_FLAG_...) */;
 	u8 thickness /*! Thickness in pixels */;
-	u8 resd;
+	u8 rop /*! Raster operation (SG_ROP_...) used when SG_PEN_FLAG_IS_ROP is set */;
 	sg_color_t color /*! Pen color */;
+	u32 dash /*! Stroke pattern used with SG_PEN_FLAG_IS_DASH (bit n is drawn if pixel n of each 32 pixel period is on) */;
+	u8 dash_phase /*! Bit of dash used for the first pixel of a stroke */;
 } sg_pen_t;
 
+/*! \brief Graphics Palette
+ * \details Maps the colors of a bitmap with fewer bits per pixel
+ * to the colors of the bitmap that the palette is assigned to.
+ *
+ * When a source pixel with value `c` is drawn, the destination
+ * color is `colors[c & mask]`.
+ */
 typedef struct MCU_PACK {
-	u32 mask;
-	sg_bmap_data_t * colors;
+	u32 mask /*! Mask applied to the source color before indexing \a colors */;
+	sg_bmap_data_t * colors /*! Destination colors */;
 } sg_palette_t;
 
+struct sg_kernel;
+
 /*! \brief Graphics Bitmap
  * \details Data structure for holding data for a bitmap.
  */
@@ -133,6 +191,7 @@ typedef struct MCU_PACK {
 	sg_size_t columns /*! The number of columns in the bitmap (used internally) */;
 	u8 bits_per_pixel /*! The number of bits in each pixel */;
 	const sg_palette_t * palette /*! palette for importing bitmaps with fewer bits per pixel */;
+	const struct sg_kernel * kernel /*! Drawing functions for bits_per_pixel (used internally, checked against bits_per_pixel before use) */;
 } sg_bmap_t;
 
 
@@ -143,6 +202,51 @@ typedef struct MCU_PACK {
 	sg_size_t shift;
 } sg_cursor_t;
 
+/*! \brief Cursor Run
+ * \details Describes a horizontal run of pixels that all have the same color.
+ * \sa sg_cursor_find_runs()
+ */
+typedef struct MCU_PACK {
+	sg_color_t color /*! Color of every pixel in the run */;
+	sg_size_t width /*! Number of pixels in the run */;
+} sg_cursor_run_t;
+
+/*! \brief Cursor Expand Table
+ * \details Lookup table for copying pixels to a bitmap with more bits
+ * per pixel than the source (built by sg_cursor_expand_init()).
+ *
+ * Each entry holds the destination pixels for one group of source
+ * pixels (a nibble or less of source bits).
+ * \sa sg_cursor_draw_cursor_expand()
+ */
+typedef struct MCU_PACK {
+	sg_bmap_data_t table[16] /*! Destination pixels for each group of source bits */;
+	u8 src_bits_per_pixel /*! Bits per pixel of the source bitmap */;
+	u8 dest_bits_per_pixel /*! Bits per pixel of the destination bitmap */;
+	u8 src_bits /*! Source bits used to index the table */;
+	u8 dest_bits /*! Destination bits in each table entry */;
+} sg_cursor_expand_t;
+
+/*! \brief Pour Span
+ * \details A span that sg_draw_pour_spans() has filled along with
+ * the direction of the row next to it that still needs to be checked.
+ * \sa sg_draw_pour_spans()
+ */
+typedef struct MCU_PACK {
+	sg_int_t y /*! Row of the span */;
+	sg_int_t left /*! First pixel in the span */;
+	sg_int_t right /*! Last pixel in the span */;
+	s8 dy /*! Row to check next (1 for below, -1 for above) */;
+} sg_pour_span_t;
+
+/*! \brief Pour Visited Words
+ * \details Number of u32 words sg_draw_pour_spans() needs for the
+ * visited mask of bounds that are \a width by \a height pixels (one bit
+ * per pixel with each row starting on a new word).
+ * \sa sg_draw_pour_spans()
+ */
+#define SG_POUR_VISITED_WORDS(width, height) ((((u32)(width) + 31) / 32) * (u32)(height))
+
 typedef struct MCU_PACK {
 	sg_size_t width;
 	sg_size_t height;
@@ -159,6 +263,17 @@ typedef struct MCU_PACK {
 	sg_area_t area /*! Area of the region */;
 } sg_region_t;
 
+/*! \brief Corner Radii
+ * \details Radius of each corner of a rectangle
+ * \sa sg_draw_round_rect()
+ */
+typedef struct MCU_PACK {
+	sg_size_t top_left /*! Radius of the top left corner */;
+	sg_size_t top_right /*! Radius of the top right corner */;
+	sg_size_t bottom_right /*! Radius of the bottom right corner */;
+	sg_size_t bottom_left /*! Radius of the bottom left corner */;
+} sg_corner_radii_t;
+
 enum {
 	SG_VECTOR_PATH_FLAG_CLOSE_PATH = (1<<0),
 	SG_VECTOR_PATH_FLAG_IS_FILL_ODD_EVEN = (1<<1),
@@ -172,6 +287,7 @@ enum {
 	SG_VECTOR_PATH_CUBIC_BEZIER /*! Cubic Bezier */,
 	SG_VECTOR_PATH_CLOSE /*! Close the path using a line */,
 	SG_VECTOR_PATH_POUR /*! Pour at the point specified */,
+	SG_VECTOR_PATH_FILL /*! Fill the area inside the outlines before this */,
 	SG_VECTOR_PATH_TOTAL
 };
 
@@ -197,6 +313,10 @@ typedef struct MCU_PACK {
 	sg_point_t point;
 } sg_vector_path_pour_t;
 
+typedef struct MCU_PACK {
+	u16 o_flags /*! SG_VECTOR_PATH_FLAG_IS_FILL_ODD_EVEN or zero for the non-zero winding rule */;
+} sg_vector_path_fill_t;
+
 /*! \brief Icon Path Structure
  * \details Describes a vector path */
 typedef struct MCU_PACK {
@@ -207,6 +327,7 @@ typedef struct MCU_PACK {
 		sg_vector_path_quadtratic_bezier_t quadratic_bezier /*! Path for quadratic bezier */;
 		sg_vector_path_cubic_bezier_t cubic_bezier /*! Path for cubic bezier*/;
 		sg_vector_path_pour_t pour /*! Pour at the specified point (cursor is not affected) */;
+		sg_vector_path_fill_t fill /*! Fill the outlines since the last fill (cursor is not affected) */;
 	};
 } sg_vector_path_description_t;
 
@@ -234,6 +355,15 @@ typedef struct MCU_PACK {
 	sg_region_t region /*! Destination for region specifications */;
 } sg_vector_path_t;
 
+/*! \brief Vector Scene Item
+ * \details One path in a scene drawn with sg_vector_draw_scene().
+ */
+typedef struct MCU_PACK {
+	sg_vector_path_t * path /*! The path to draw */;
+	const sg_vector_map_t * map /*! Where the path is drawn */;
+	const sg_pen_t * pen /*! Pen for the path (null to use the bitmap's pen) */;
+} sg_vector_scene_item_t;
+
 /*! \details Header for a file that
  * holds vector icon descriptions.
  *
@@ -27,3 +27,35 @@ include(${SOS_TOOLCHAIN_CMAKE_PATH}/sos-lib.cmake)
 set(SOS_OPTION 8bpp)
 set(SOS_DEFINITIONS SG_BITS_PER_PIXEL=8)
 include(${SOS_TOOLCHAIN_CMAKE_PATH}/sos-lib.cmake)
+
+#Tests run on the host
+enable_testing()
+add_executable(sg_fill_test ${CMAKE_SOURCE_DIR}/test/sg_fill_test.c ${SOURCES})
+target_include_directories(sg_fill_test PRIVATE ${CMAKE_SOURCE_DIR}/include ${CMAKE_SOURCE_DIR}/src)
+target_compile_definitions(sg_fill_test PRIVATE __link SG_BITS_PER_PIXEL=8)
+add_test(NAME sg_fill_test COMMAND sg_fill_test)
+
+add_executable(sg_fill_test_variable ${CMAKE_SOURCE_DIR}/test/sg_fill_test.c ${SOURCES})
+target_include_directories(sg_fill_test_variable PRIVATE ${CMAKE_SOURCE_DIR}/include ${CMAKE_SOURCE_DIR}/src)
+target_compile_definitions(sg_fill_test_variable PRIVATE __link SG_BITS_PER_PIXEL=0)
+add_test(NAME sg_fill_test_variable COMMAND sg_fill_test_variable)
+
+add_executable(sg_polyline_test ${CMAKE_SOURCE_DIR}/test/sg_polyline_test.c ${SOURCES})
+target_include_directories(sg_polyline_test PRIVATE ${CMAKE_SOURCE_DIR}/include ${CMAKE_SOURCE_DIR}/src)
+target_compile_definitions(sg_polyline_test PRIVATE __link SG_BITS_PER_PIXEL=8)
+add_test(NAME sg_polyline_test COMMAND sg_polyline_test)
+
+add_executable(sg_rectangles_test ${CMAKE_SOURCE_DIR}/test/sg_rectangles_test.c ${SOURCES})
+target_include_directories(sg_rectangles_test PRIVATE ${CMAKE_SOURCE_DIR}/include ${CMAKE_SOURCE_DIR}/src)
+target_compile_definitions(sg_rectangles_test PRIVATE __link SG_BITS_PER_PIXEL=8)
+add_test(NAME sg_rectangles_test COMMAND sg_rectangles_test)
+
+add_executable(sg_pour_test ${CMAKE_SOURCE_DIR}/test/sg_pour_test.c ${SOURCES})
+target_include_directories(sg_pour_test PRIVATE ${CMAKE_SOURCE_DIR}/include ${CMAKE_SOURCE_DIR}/src)
+target_compile_definitions(sg_pour_test PRIVATE __link SG_BITS_PER_PIXEL=8)
+add_test(NAME sg_pour_test COMMAND sg_pour_test)
+
+#Timing only (not run by ctest)
+add_executable(sg_pattern_bench ${CMAKE_SOURCE_DIR}/test/sg_pattern_bench.c ${SOURCES})
+target_include_directories(sg_pattern_bench PRIVATE ${CMAKE_SOURCE_DIR}/include ${CMAKE_SOURCE_DIR}/src)
+target_compile_definitions(sg_pattern_bench PRIVATE __link SG_BITS_PER_PIXEL=0)
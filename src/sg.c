@@ -24,6 +24,7 @@ void sg_bmap_set_data(sg_bmap_t * bmap, sg_bmap_data_t * mem, sg_area_t area, u8
 	bmap->margin_top_left.width = 0;
 	bmap->margin_top_left.height = 0;
 	bmap->palette = 0;
+	bmap->kernel = sg_cursor_kernel(bmap->bits_per_pixel);
 }
 
 size_t sg_calc_bmap_size(const sg_bmap_t * bmap, sg_area_t area){
@@ -60,6 +60,7 @@ const sg_api_t sg_api = {
 	.cursor_shift_left = sg_cursor_shift_left,
 	.cursor_find_positive_edge = sg_cursor_find_positive_edge,
 	.cursor_find_negative_edge = sg_cursor_find_negative_edge,
+	.cursor_find_edge = sg_cursor_find_edge,
 
 	//drawing
 	.get_pixel = sg_get_pixel,
@@ -82,7 +83,23 @@ const sg_api_t sg_api = {
 	.animate_init = sg_animate_init,
 
 	.antialias_filter_init = sg_antialias_filter_init,
-	.antialias_filter_apply = sg_antialias_filter_apply
+	.antialias_filter_apply = sg_antialias_filter_apply,
+
+	.cursor_expand_init = sg_cursor_expand_init,
+	.cursor_draw_cursor_expand = sg_cursor_draw_cursor_expand,
+	.cursor_find_runs = sg_cursor_find_runs,
+	.cursor_advance = sg_cursor_advance,
+	.cursor_draw_cursor_rop = sg_cursor_draw_cursor_rop,
+	.draw_sub_bitmap_rop = sg_draw_sub_bitmap_rop,
+	.draw_polyline = sg_draw_polyline,
+	.draw_round_rect = sg_draw_round_rect,
+	.draw_circle_filled = sg_draw_circle_filled,
+	.draw_polygon_filled = sg_draw_polygon_filled,
+	.draw_triangle_filled = sg_draw_triangle_filled,
+	.draw_rectangles = sg_draw_rectangles,
+	.draw_pour_spans = sg_draw_pour_spans,
+	.draw_downsample = sg_draw_downsample,
+	.vector_draw_scene = sg_vector_draw_scene
 
 };
 
@@ -23,8 +23,171 @@
 #define SG_PIXEL_MASK(bmap) ((1<<SG_BITS_PER_PIXEL_VALUE(bmap)) - 1)
 
 
+//forces a function to be inlined so that it is specialized for constant arguments
+#if defined __GNUC__
+#define SG_KERNEL_INLINE static inline __attribute__((always_inline))
+#else
+#define SG_KERNEL_INLINE static inline
+#endif
+
+/*
+ * Drawing functions specialized for a pixel size
+ *
+ * sg_bmap_set_data() assigns the table that matches the bitmap's
+ * bits per pixel to sg_bmap_t.kernel. The table is looked up again if its
+ * bits_per_pixel no longer matches the bitmap.
+ *
+ */
+typedef struct sg_kernel {
+	u8 bits_per_pixel /*! Bits per pixel the table was built for (0 reads them from the bitmap) */;
+	sg_color_t (*get_pixel)(sg_cursor_t * cursor) /*! Reads a pixel and increments the cursor */;
+	void (*draw_pixel)(sg_cursor_t * cursor, sg_color_t color) /*! Draws a pixel and increments the cursor */;
+	void (*draw_pattern)(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern) /*! Span fill */;
+	void (*draw_dash)(sg_cursor_t * cursor, sg_size_t width, u32 dash, u32 phase) /*! Span fill masked by a dash pattern */;
+	void (*draw_cursor)(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width) /*! Blit with the same bits per pixel */;
+	sg_size_t (*find_pixel)(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, int is_find_equal) /*! Edge find */;
+	sg_size_t (*find_pixel_reverse)(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, int is_find_equal) /*! Edge find toward lower x */;
+} sg_kernel_t;
+
+const sg_kernel_t * sg_cursor_kernel(u8 bits_per_pixel);
+
+/*
+ * The bitmap's pen prepared for drawing
+ *
+ * The pen color is pre-expanded to a full word and the pen flags are
+ * resolved to a single raster operation. It is built on the stack by
+ * each drawing call (sg_pen_rop_init()) so the bitmap is never written.
+ *
+ */
+typedef struct {
+	u8 rop /*! Raster operation code selected by the pen flags */;
+	u8 is_zero_transparent /*! Non-zero if zero pixels are not assigned */;
+	sg_bmap_data_t pattern /*! Pen color repeated across a word */;
+	sg_bmap_data_t pixel_mask /*! Mask for a single pixel */;
+	void (*draw_word)(sg_bmap_data_t * word, sg_bmap_data_t pattern, sg_bmap_data_t mask) /*! Applies the raster operation to the bits set in mask */;
+} sg_pen_rop_t;
+
+void sg_pen_rop_init(sg_pen_rop_t * pen_rop, const sg_bmap_t * bmap);
+
+//applies the binary raster operation rop (SG_ROP_...) to each bit of pattern and dest
+SG_KERNEL_INLINE sg_bmap_data_t sg_calc_rop(u32 rop, sg_bmap_data_t pattern, sg_bmap_data_t dest){
+	//result for each pattern bit where the dest bit is zero and where it is one
+	sg_bmap_data_t zero = (pattern & -(sg_bmap_data_t)((rop >> 2) & 1)) | (~pattern & -(sg_bmap_data_t)(rop & 1));
+	sg_bmap_data_t one = (pattern & -(sg_bmap_data_t)((rop >> 3) & 1)) | (~pattern & -(sg_bmap_data_t)((rop >> 1) & 1));
+	return (dest & one) | (~dest & zero);
+}
+
+//applies the ternary raster operation rop (see SG_ROP3_PATTERN) to each bit of pattern, source and dest
+SG_KERNEL_INLINE sg_bmap_data_t sg_calc_rop3(u32 rop, sg_bmap_data_t pattern, sg_bmap_data_t source, sg_bmap_data_t dest){
+	return (pattern & sg_calc_rop(rop >> 4, source, dest)) | (~pattern & sg_calc_rop(rop & 0x0f, source, dest));
+}
+
+//non-zero if the pen blends antialiased edges on this bitmap (2, 4 or 8 bits per pixel)
+static inline int sg_pen_is_antialiased(const sg_bmap_t * bmap){
+	const u32 bits_per_pixel = SG_BITS_PER_PIXEL_VALUE(bmap);
+	return (bmap->pen.o_flags & SG_PEN_FLAG_IS_ANTIALIAS) &&
+			(bits_per_pixel >= 2) && (bits_per_pixel <= 8);
+}
+
+//integer square root (rounded down)
+u32 sg_calc_sqrt(u64 value);
+
 sg_color_t sg_cursor_get_pixel_no_increment(sg_cursor_t * cursor);
 void sg_cursor_draw_pixel_no_increment(sg_cursor_t * cursor);
 
+//number of pixels before the first one that is color (or is not color if is_find_equal is zero); the cursor is left on that pixel
+sg_size_t sg_cursor_find_color(sg_cursor_t * cursor, sg_size_t width, sg_color_t color, int is_find_equal);
+//same as sg_cursor_find_color() but scans toward lower x starting with the pixel at cursor
+sg_size_t sg_cursor_find_color_reverse(sg_cursor_t * cursor, sg_size_t width, sg_color_t color, int is_find_equal);
+//draws the pen's color on the pixels whose bit of dash is set (bit phase goes with the pixel at cursor)
+void sg_cursor_draw_dash(sg_cursor_t * cursor, sg_size_t width, u32 dash, u32 phase);
+
+//fills count aligned words (uses a vector kernel on link builds when available)
+void sg_fill_words(sg_bmap_data_t * target, u32 count, sg_bmap_data_t pattern, sg_bmap_data_t mask, u8 rop);
+//kernels that sg_fill_words() chooses from
+enum sg_fill_kernel {
+	SG_FILL_KERNEL_PORTABLE,
+	SG_FILL_KERNEL_SSE2,
+	SG_FILL_KERNEL_AVX2,
+	SG_FILL_KERNEL_TOTAL
+};
+
+//same as sg_fill_words() using only kernel (returns -1 if it isn't compiled in or the processor can't run it; test/sg_fill_test.c checks each one)
+int sg_fill_words_kernel(u32 kernel, sg_bmap_data_t * target, u32 count, sg_bmap_data_t pattern, sg_bmap_data_t mask, u8 rop);
+
+/*
+ * Bresenham walk for a line that has already been clipped
+ *
+ * The line steps one pixel along the major axis for each pixel drawn. The
+ * error term is increased by error_step on each pixel and when it reaches
+ * error_limit, the line also steps along the minor axis.
+ *
+ */
+typedef struct {
+	u32 count /*! Number of pixels to draw (starting at the cursor) */;
+	u32 error /*! Error term for the first pixel (less than error_limit) */;
+	u32 error_step /*! Twice the minor axis delta */;
+	u32 error_limit /*! Twice the major axis delta */;
+	s8 step_x /*! 1 or -1 */;
+	s8 step_y /*! 1 or -1 */;
+	u8 is_y_major /*! Non-zero if the line steps along y on every pixel */;
+} sg_cursor_line_t;
+
+void sg_cursor_draw_line(sg_cursor_t * cursor, const sg_cursor_line_t * line);
+
+/*
+ * Collects points for a polyline (see sg_draw_polyline())
+ *
+ * The points are drawn in batches as the buffer fills. Each batch
+ * continues from the last point of the one before so the joints
+ * are still only drawn once (and a dash pattern carries on from where
+ * it left off). For thick lines, the last few points of a batch are
+ * kept so the next one can skip the pixels they drew. Repeated points
+ * are ignored.
+ *
+ */
+#define SG_POLYLINE_POINTS 32
+
+typedef struct {
+	const sg_bmap_t * bmap;
+	u32 count;
+	u8 drawn /*! Points at the start of points that were drawn with the last batch (kept so thick lines don't draw over them) */;
+	u8 dash_phase /*! Bit of the pen's dash pattern for the next pixel */;
+	sg_point_t points[SG_POLYLINE_POINTS];
+} sg_polyline_t;
+
+void sg_polyline_start(sg_polyline_t * polyline, const sg_bmap_t * bmap);
+void sg_polyline_add(sg_polyline_t * polyline, sg_point_t p);
+void sg_polyline_finish(sg_polyline_t * polyline);
+
+//draws the spans on row y with the pen (spans may overlap and extend past the bitmap)
+void sg_draw_row_spans(const sg_bmap_t * bmap, sg_int_t y, sg_region_t * spans, sg_int_t count);
+//moves each pixel from (x, y) coverage[i]/256 of the way to the pen color (the row must be inside the bitmap)
+void sg_draw_coverage_row(const sg_bmap_t * bmap, sg_int_t x, sg_int_t y, const u16 * coverage, sg_size_t width);
+
+//one axis of a bezier curve being stepped with forward differences (fixed point)
+typedef struct {
+	s64 value /*! Coordinate plus one half */;
+	s64 step1;
+	s64 step2;
+	s64 step3;
+} sg_bezier_axis_t;
+
+//a bezier curve being flattened into line segments (see sg_bezier_start())
+typedef struct {
+	sg_bezier_axis_t axis[2];
+	sg_point_t end;
+	u32 segments;
+	u32 step;
+} sg_bezier_t;
+
+//starts flattening a quadratic (points[0] to points[2]) or cubic bezier curve
+void sg_bezier_start(sg_bezier_t * bezier, const sg_point_t * points, int is_cubic);
+//gets the end of the next segment (points[0] is not included); returns zero at the end of the curve
+int sg_bezier_next(sg_bezier_t * bezier, sg_point_t * p);
+
+//adds a flattened quadratic (points[0] to points[2]) or cubic bezier curve and grows corners to enclose it
+void sg_polyline_add_bezier(sg_polyline_t * polyline, const sg_point_t * points, int is_cubic, sg_point_t * corners);
+
 
 #endif /* SG_CONFIG_H_ */
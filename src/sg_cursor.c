@@ -11,13 +11,160 @@ typedef struct {
 
 static sg_color_t create_pattern(const sg_bmap_t * bmap, sg_color_t color);
 
-static sg_size_t calc_pixels_until_first_boundary(const sg_cursor_t * cursor, sg_size_t w, sg_size_t shift);
-static sg_size_t calc_aligned_words(const sg_cursor_t * cursor, sg_size_t w, sg_size_t pixels_until_first_boundary);
-static sg_size_t calc_pixels_after_last_boundary(const sg_cursor_t * cursor, sg_size_t w, sg_size_t pixels_until_first_boundary, sg_size_t aligned_words);
 static void copy_pixel(sg_cursor_t * dest, sg_cursor_t * src);
+static void draw_cursor_rop_pixels(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, sg_bmap_data_t pattern, u8 rop);
+static sg_color_t expand_color(const sg_bmap_t * bmap, sg_color_t color);
 static void draw_pixel(const sg_cursor_t * cursor, sg_color_t color);
-static void draw_pixel_group(sg_bmap_data_t * word, sg_bmap_data_t pattern, sg_bmap_data_t mask, u16 o_flags);
+static inline void draw_pixel_span(sg_bmap_data_t * word, sg_bmap_data_t pattern, sg_bmap_data_t span_mask, sg_bmap_data_t opaque_mask, const sg_pen_rop_t * pen_rop);
+static sg_color_t convert_color(const sg_bmap_t * dest, const sg_bmap_t * src, sg_color_t color);
+static inline sg_bmap_data_t calc_head_mask(u32 shift);
+static inline sg_bmap_data_t calc_tail_mask(u32 bits);
+static void move_bits(sg_bmap_data_t * base, s32 dest_bit, s32 src_bit, u32 bits);
+static void clear_bits(sg_bmap_data_t * base, s32 start_bit, u32 bits);
+static sg_bmap_data_t calc_move_mask(s32 k, s32 first, s32 last, s32 dest_bit, u32 dest_end);
+static inline sg_bmap_data_t read_word(const sg_bmap_data_t * base, s32 index, s32 first, s32 last);
+static inline s32 floor_words(s32 bits);
+static inline u32 rotate_dash(u32 dash, u32 n);
 static inline sg_color_t get_pixel(const sg_cursor_t * cursor);
+static inline sg_bmap_data_t funnel_shift(sg_bmap_data_t low, sg_bmap_data_t high, u32 funnel);
+
+/*
+ * Kernels
+ *
+ * These functions take the bits per pixel as an argument. They are always
+ * inlined so that when they are called with a constant, the compiler
+ * specializes them for that pixel size. A value of zero means the bits per
+ * pixel are read from the cursor's bitmap.
+ *
+ * The SG_BITS_PER_PIXEL=0 build creates a table of kernels for each supported
+ * pixel size and sg_bmap_set_data() assigns the matching table to the
+ * bitmap. Fixed builds call the kernels for SG_BITS_PER_PIXEL directly.
+ *
+ */
+SG_KERNEL_INLINE u32 kernel_bpp(const sg_bmap_t * bmap, u32 bits_per_pixel);
+SG_KERNEL_INLINE sg_bmap_data_t calc_opaque_mask(u32 bpp, sg_bmap_data_t pattern);
+SG_KERNEL_INLINE sg_bmap_data_t calc_transparent_opaque_mask(u32 bpp, sg_bmap_data_t pattern, const sg_pen_rop_t * pen_rop);
+SG_KERNEL_INLINE sg_color_t get_pixel_kernel(sg_cursor_t * cursor, u32 bits_per_pixel);
+SG_KERNEL_INLINE void draw_pixel_kernel(sg_cursor_t * cursor, sg_color_t color, u32 bits_per_pixel);
+SG_KERNEL_INLINE void draw_pattern_kernel(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, u32 bits_per_pixel);
+SG_KERNEL_INLINE void draw_dash_kernel(sg_cursor_t * cursor, sg_size_t width, u32 dash, u32 phase, u32 bits_per_pixel);
+SG_KERNEL_INLINE sg_bmap_data_t calc_dash_mask(u32 bpp, u32 bits);
+SG_KERNEL_INLINE void draw_cursor_kernel(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, u32 bits_per_pixel);
+SG_KERNEL_INLINE sg_size_t find_pixel_kernel(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, int is_find_equal, u32 bits_per_pixel);
+SG_KERNEL_INLINE sg_size_t find_pixel_reverse_kernel(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, int is_find_equal, u32 bits_per_pixel);
+
+#define SG_CURSOR_KERNEL(name, bits_per_pixel) \
+	static sg_color_t name##_get_pixel(sg_cursor_t * cursor){ return get_pixel_kernel(cursor, bits_per_pixel); } \
+	static void name##_draw_pixel(sg_cursor_t * cursor, sg_color_t color){ draw_pixel_kernel(cursor, color, bits_per_pixel); } \
+	static void name##_draw_pattern(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern){ draw_pattern_kernel(cursor, width, pattern, bits_per_pixel); } \
+	static void name##_draw_dash(sg_cursor_t * cursor, sg_size_t width, u32 dash, u32 phase){ draw_dash_kernel(cursor, width, dash, phase, bits_per_pixel); } \
+	static void name##_draw_cursor(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width){ draw_cursor_kernel(dest_cursor, src_cursor, width, bits_per_pixel); } \
+	static sg_size_t name##_find_pixel(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, int is_find_equal){ return find_pixel_kernel(cursor, width, pattern, is_find_equal, bits_per_pixel); } \
+	static sg_size_t name##_find_pixel_reverse(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, int is_find_equal){ return find_pixel_reverse_kernel(cursor, width, pattern, is_find_equal, bits_per_pixel); }
+
+#define SG_CURSOR_KERNEL_TABLE(name, bits) { \
+		.bits_per_pixel = bits, \
+		.get_pixel = name##_get_pixel, \
+		.draw_pixel = name##_draw_pixel, \
+		.draw_pattern = name##_draw_pattern, \
+		.draw_dash = name##_draw_dash, \
+		.draw_cursor = name##_draw_cursor, \
+		.find_pixel = name##_find_pixel, \
+		.find_pixel_reverse = name##_find_pixel_reverse \
+	}
+
+#if SG_BITS_PER_PIXEL == 0
+SG_CURSOR_KERNEL(kernel_variable, 0)
+SG_CURSOR_KERNEL(kernel_1bpp, 1)
+SG_CURSOR_KERNEL(kernel_2bpp, 2)
+SG_CURSOR_KERNEL(kernel_4bpp, 4)
+SG_CURSOR_KERNEL(kernel_8bpp, 8)
+SG_CURSOR_KERNEL(kernel_16bpp, 16)
+
+static const sg_kernel_t cursor_kernels[] = {
+	SG_CURSOR_KERNEL_TABLE(kernel_variable, 0),
+	SG_CURSOR_KERNEL_TABLE(kernel_1bpp, 1),
+	SG_CURSOR_KERNEL_TABLE(kernel_2bpp, 2),
+	SG_CURSOR_KERNEL_TABLE(kernel_4bpp, 4),
+	SG_CURSOR_KERNEL_TABLE(kernel_8bpp, 8),
+	SG_CURSOR_KERNEL_TABLE(kernel_16bpp, 16)
+};
+
+/*
+ * The bitmap's table is only used if it is one of the tables above and
+ * it was built for the bitmap's bits per pixel. A bitmap that wasn't set
+ * up with sg_bmap_set_data() (so kernel isn't initialized) or whose bits
+ * per pixel changed afterwards looks up its table again.
+ *
+ */
+static inline const sg_kernel_t * cursor_kernel(const sg_bmap_t * bmap){
+	const sg_kernel_t * kernel = bmap->kernel;
+	const uintptr_t offset = (uintptr_t)kernel - (uintptr_t)cursor_kernels;
+	if( (offset < sizeof(cursor_kernels)) &&
+			(offset % sizeof(sg_kernel_t) == 0) &&
+			(kernel->bits_per_pixel == bmap->bits_per_pixel) ){
+		return kernel;
+	}
+	return sg_cursor_kernel(bmap->bits_per_pixel);
+}
+
+#define CURSOR_KERNEL(bmap, function) (cursor_kernel(bmap)->function)
+#else
+SG_CURSOR_KERNEL(kernel_fixed, SG_BITS_PER_PIXEL)
+static const sg_kernel_t kernel_fixed = SG_CURSOR_KERNEL_TABLE(kernel_fixed, SG_BITS_PER_PIXEL);
+#define CURSOR_KERNEL(bmap, function) kernel_fixed_##function
+#endif
+
+const sg_kernel_t * sg_cursor_kernel(u8 bits_per_pixel){
+#if SG_BITS_PER_PIXEL == 0
+	switch(bits_per_pixel){
+	case 1: return cursor_kernels + 1;
+	case 2: return cursor_kernels + 2;
+	case 4: return cursor_kernels + 3;
+	case 8: return cursor_kernels + 4;
+	case 16: return cursor_kernels + 5;
+	}
+	return cursor_kernels;
+#else
+	MCU_UNUSED_ARGUMENT(bits_per_pixel);
+	return &kernel_fixed;
+#endif
+}
+
+/*
+ * Word level raster operations
+ *
+ * One function is generated for each of the 16 binary raster operations so
+ * that sg_calc_rop() is reduced to the minimum number of logical operations.
+ * The pen's compiled descriptor points to the function for its operation.
+ *
+ */
+#define SG_ROP_FUNCTION(code) \
+	static void rop_##code(sg_bmap_data_t * word, sg_bmap_data_t pattern, sg_bmap_data_t mask){ \
+		*word = (*word & ~mask) | (sg_calc_rop(code, pattern, *word) & mask); \
+	}
+
+SG_ROP_FUNCTION(0x0)
+SG_ROP_FUNCTION(0x1)
+SG_ROP_FUNCTION(0x2)
+SG_ROP_FUNCTION(0x3)
+SG_ROP_FUNCTION(0x4)
+SG_ROP_FUNCTION(0x5)
+SG_ROP_FUNCTION(0x6)
+SG_ROP_FUNCTION(0x7)
+SG_ROP_FUNCTION(0x8)
+SG_ROP_FUNCTION(0x9)
+SG_ROP_FUNCTION(0xa)
+SG_ROP_FUNCTION(0xb)
+SG_ROP_FUNCTION(0xc)
+SG_ROP_FUNCTION(0xd)
+SG_ROP_FUNCTION(0xe)
+SG_ROP_FUNCTION(0xf)
+
+static void (* const rop_functions[16])(sg_bmap_data_t * word, sg_bmap_data_t pattern, sg_bmap_data_t mask) = {
+	rop_0x0, rop_0x1, rop_0x2, rop_0x3, rop_0x4, rop_0x5, rop_0x6, rop_0x7,
+	rop_0x8, rop_0x9, rop_0xa, rop_0xb, rop_0xc, rop_0xd, rop_0xe, rop_0xf
+};
 
 //cursor with a single pixel
 void sg_cursor_set(sg_cursor_t * cursor, const sg_bmap_t * bmap, sg_point_t p){
@@ -51,9 +198,7 @@ void sg_cursor_draw_pixel_no_increment(sg_cursor_t * cursor){
 
 
 sg_color_t sg_cursor_get_pixel(sg_cursor_t * cursor){
-	sg_color_t color = get_pixel(cursor);
-	sg_cursor_inc_x(cursor);
-	return color;
+	return CURSOR_KERNEL(cursor->bmap, get_pixel)(cursor);
 }
 
 void sg_cursor_dec_x(sg_cursor_t * cursor){
@@ -76,14 +221,13 @@ void sg_cursor_inc_y(sg_cursor_t * cursor){
 }
 
 void sg_cursor_draw_pixel(sg_cursor_t * cursor){
-	draw_pixel(cursor, cursor->bmap->pen.color);
-	sg_cursor_inc_x(cursor);
+	CURSOR_KERNEL(cursor->bmap, draw_pixel)(cursor, cursor->bmap->pen.color);
 }
 
 void sg_cursor_draw_hline(sg_cursor_t * cursor, sg_size_t width){
-	sg_bmap_data_t pattern;
-	pattern = create_pattern(cursor->bmap, cursor->bmap->pen.color);
-	sg_cursor_draw_pattern(cursor, width, pattern);
+	sg_pen_rop_t pen_rop;
+	sg_pen_rop_init(&pen_rop, cursor->bmap);
+	sg_cursor_draw_pattern(cursor, width, pen_rop.pattern);
 }
 
 sg_int_t sg_cursor_find_edge(
@@ -91,203 +235,282 @@ sg_int_t sg_cursor_find_edge(
 		sg_color_t current_color,
 		sg_size_t width
 		){
-	sg_size_t pixels_until_first_boundary;
-	sg_size_t pixels_after_last_boundary;
-	sg_size_t aligned_words;
-	sg_size_t i;
-	sg_bmap_data_t color;
-	sg_size_t result = 0;
+	return CURSOR_KERNEL(cursor->bmap, find_pixel)(cursor, width, create_pattern(cursor->bmap, current_color), 0);
+}
+
+sg_int_t sg_cursor_find_positive_edge(
+		sg_cursor_t * cursor,
+		sg_size_t width
+		){
+	//first pixel that is not zero
+	return CURSOR_KERNEL(cursor->bmap, find_pixel)(cursor, width, 0, 0);
+}
 
-	pixels_until_first_boundary =
-			calc_pixels_until_first_boundary(cursor, width, cursor->shift);
+sg_int_t sg_cursor_find_negative_edge(
+		sg_cursor_t * cursor,
+		sg_size_t width
+		){
+	//first pixel that is zero
+	return CURSOR_KERNEL(cursor->bmap, find_pixel)(cursor, width, 0, 1);
+}
 
-	for(i=0; i < pixels_until_first_boundary; i++){
-		color = sg_cursor_get_pixel_no_increment(cursor);
-		if( color != current_color ){
-			return result;
-		}
-		sg_cursor_inc_x(cursor);
-		result++;
+u32 sg_cursor_find_runs(
+		sg_cursor_t * cursor,
+		sg_size_t width,
+		sg_cursor_run_t * runs,
+		u32 max_runs
+		){
+	u32 count = 0;
+	sg_color_t color;
+	sg_size_t run_width;
+
+	while( (width > 0) && (count < max_runs) ){
+		color = get_pixel(cursor);
+		run_width = CURSOR_KERNEL(cursor->bmap, find_pixel)(cursor, width, create_pattern(cursor->bmap, color), 0);
+		runs[count].color = color;
+		runs[count].width = run_width;
+		count++;
+		width -= run_width;
 	}
 
-	aligned_words =
-			calc_aligned_words(cursor, width, pixels_until_first_boundary);
+	return count;
+}
 
-	sg_color_t color_pattern = create_pattern(cursor->bmap, current_color);
+/*
+ * Scans width pixels at cursor for the first pixel that differs from the pixels in
+ * pattern (or that matches them if is_find_equal is set)
+ *
+ * Each word is XOR'd with the pattern and folded to one mask bit per
+ * pixel so that a whole word is checked at once. Counting the trailing zeros
+ * of the mask gives the location of the edge. The cursor is left pointing
+ * at the edge (or just past the last pixel if there isn't one).
+ *
+ */
+sg_size_t find_pixel_kernel(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, int is_find_equal, u32 bits_per_pixel){
+	const u32 bpp = kernel_bpp(cursor->bmap, bits_per_pixel);
+	sg_bmap_data_t * word = cursor->target;
+	u32 start = cursor->shift;
+	u32 end = start + (u32)width * bpp;
+	u32 offset = 0;
+	sg_bmap_data_t mask;
+	sg_bmap_data_t found;
 
-	for(i=0; i < aligned_words; i++){
-		if( *cursor->target != color_pattern ){
-			for(i=0; i < SG_PIXELS_PER_WORD(cursor->bmap); i++){
-				color = sg_cursor_get_pixel_no_increment(cursor);
-				if( color != current_color ){
-					return result;
-				}
-				sg_cursor_inc_x(cursor);
-				result++;
-			}
-		} else {
-			cursor->target++;
-			result += SG_PIXELS_PER_WORD(cursor->bmap);
-		}
+	if( width == 0 ){
+		return 0;
 	}
 
-	pixels_after_last_boundary =
-			calc_pixels_after_last_boundary(cursor, width, pixels_until_first_boundary, aligned_words);
+	mask = calc_head_mask(start);
+	do {
+		if( end - offset <= SG_BITS_PER_WORD ){
+			mask &= calc_tail_mask(end - offset);
+		}
 
-	for(i=0; i < pixels_after_last_boundary; i++){
-		color = sg_cursor_get_pixel_no_increment(cursor);
-		if( color != current_color ){
-			return result;
+		found = calc_opaque_mask(bpp, *word ^ pattern);
+		if( is_find_equal ){
+			found = ~found;
+		}
+		found &= mask;
+
+		if( found ){
+			cursor->target = word;
+			cursor->shift = __builtin_ctz(found);
+			return (offset + cursor->shift - start) / bpp;
 		}
-		sg_cursor_inc_x(cursor);
-		result++;
-	}
 
+		mask = (sg_bmap_data_t)-1;
+		offset += SG_BITS_PER_WORD;
+		word++;
+	} while( offset < end );
+
+	cursor->target += end / SG_BITS_PER_WORD;
+	cursor->shift = end % SG_BITS_PER_WORD;
 	return width;
 }
 
-sg_int_t sg_cursor_find_positive_edge(
-		sg_cursor_t * cursor,
-		sg_size_t width
-		){
-	sg_size_t pixels_until_first_boundary;
-	sg_size_t pixels_after_last_boundary;
-	sg_size_t aligned_words;
-	sg_size_t i;
-	sg_bmap_data_t color;
-	sg_size_t result = 0;
+sg_size_t sg_cursor_find_color(sg_cursor_t * cursor, sg_size_t width, sg_color_t color, int is_find_equal){
+	return CURSOR_KERNEL(cursor->bmap, find_pixel)(cursor, width, create_pattern(cursor->bmap, color), is_find_equal);
+}
+
+sg_size_t sg_cursor_find_color_reverse(sg_cursor_t * cursor, sg_size_t width, sg_color_t color, int is_find_equal){
+	return CURSOR_KERNEL(cursor->bmap, find_pixel_reverse)(cursor, width, create_pattern(cursor->bmap, color), is_find_equal);
+}
 
-	pixels_until_first_boundary =
-			calc_pixels_until_first_boundary(cursor, width, cursor->shift);
-	aligned_words =
-			calc_aligned_words(cursor, width, pixels_until_first_boundary);
-	pixels_after_last_boundary =
-			calc_pixels_after_last_boundary(cursor, width, pixels_until_first_boundary, aligned_words);
+/*
+ * Same as find_pixel_kernel() but scans toward lower x starting with the
+ * pixel at cursor
+ *
+ * The highest set bit of the folded mask is the top bit of the nearest
+ * matching pixel. The cursor is left pointing at the edge (or at the last
+ * pixel scanned if there isn't one).
+ *
+ */
+sg_size_t find_pixel_reverse_kernel(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, int is_find_equal, u32 bits_per_pixel){
+	const u32 bpp = kernel_bpp(cursor->bmap, bits_per_pixel);
+	sg_bmap_data_t * word = cursor->target;
+	//bit range [start, end) relative to the start of the cursor's word
+	const s32 end = cursor->shift + bpp;
+	const s32 start = end - (s32)width * bpp;
+	s32 offset = 0;
+	sg_bmap_data_t mask;
+	sg_bmap_data_t found;
+	u32 shift;
 
+	if( width == 0 ){
+		return 0;
+	}
 
-	for(i=0; i < pixels_until_first_boundary; i++){
-		color = sg_cursor_get_pixel_no_increment(cursor);
-		if( color != 0 ){
-			return result;
+	mask = calc_tail_mask(end);
+	while( 1 ){
+		if( start >= offset ){
+			mask &= calc_head_mask(start - offset);
 		}
-		sg_cursor_inc_x(cursor);
-		result++;
-	}
 
-	for(i=0; i < aligned_words; i++){
-		if( *cursor->target != 0 ){
-			for(i=0; i < SG_PIXELS_PER_WORD(cursor->bmap); i++){
-				color = sg_cursor_get_pixel_no_increment(cursor);
-				if( color != 0 ){
-					return result;
-				}
-				sg_cursor_inc_x(cursor);
-				result++;
-			}
-		} else {
-			cursor->target++;
-			result += SG_PIXELS_PER_WORD(cursor->bmap);
+		found = calc_opaque_mask(bpp, *word ^ pattern);
+		if( is_find_equal ){
+			found = ~found;
+		}
+		found &= mask;
+
+		if( found ){
+			shift = (SG_BITS_PER_WORD - 1 - __builtin_clz(found)) & ~(bpp - 1);
+			cursor->target = word;
+			cursor->shift = shift;
+			return (end - bpp - (offset + (s32)shift)) / bpp;
 		}
-	}
 
-	for(i=0; i < pixels_after_last_boundary; i++){
-		color = sg_cursor_get_pixel_no_increment(cursor);
-		if( color != 0 ){
-			return result;
+		if( start >= offset ){
+			break;
 		}
-		sg_cursor_inc_x(cursor);
-		result++;
+
+		mask = (sg_bmap_data_t)-1;
+		offset -= SG_BITS_PER_WORD;
+		word--;
 	}
 
+	cursor->target += floor_words(start);
+	cursor->shift = start - floor_words(start) * SG_BITS_PER_WORD;
 	return width;
 }
 
-sg_int_t sg_cursor_find_negative_edge(
-		sg_cursor_t * cursor,
-		sg_size_t width
-		){
-	sg_size_t pixels_until_first_boundary;
-	sg_size_t pixels_after_last_boundary;
-	sg_size_t aligned_words;
-	sg_size_t i;
-	sg_bmap_data_t color;
-	sg_size_t result = 0;
-
-	pixels_until_first_boundary =
-			calc_pixels_until_first_boundary(cursor, width, cursor->shift);
-	aligned_words =
-			calc_aligned_words(cursor, width, pixels_until_first_boundary);
-	pixels_after_last_boundary =
-			calc_pixels_after_last_boundary(cursor, width, pixels_until_first_boundary, aligned_words);
+void sg_cursor_draw_pattern(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern){
+	CURSOR_KERNEL(cursor->bmap, draw_pattern)(cursor, width, pattern);
+}
 
+void draw_pattern_kernel(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern, u32 bits_per_pixel){
+	const u32 bpp = kernel_bpp(cursor->bmap, bits_per_pixel);
+	u32 end_shift;
+	u32 aligned_words;
+	sg_bmap_data_t opaque_mask;
+	sg_pen_rop_t pen_rop;
 
-	for(i=0; i < pixels_until_first_boundary; i++){
-		color = sg_cursor_get_pixel_no_increment(cursor);
-		if( color == 0 ){
-			return result;
-		}
-		sg_cursor_inc_x(cursor);
-		result++;
+	if( width == 0 ){
+		return;
 	}
 
-	for(i=0; i < aligned_words; i++){
-		if( *cursor->target != 0xffffffff ){
-			for(i=0; i < SG_PIXELS_PER_WORD(cursor->bmap); i++){
-				color = sg_cursor_get_pixel_no_increment(cursor);
-				if( color == 0 ){
-					return result;
-				}
-				sg_cursor_inc_x(cursor);
-				result++;
-			}
-		} else {
+	sg_pen_rop_init(&pen_rop, cursor->bmap);
+
+	//zero pixels in the pattern are left untouched in zero transparent mode
+	opaque_mask = calc_transparent_opaque_mask(bpp, pattern, &pen_rop);
+
+	//bit position (relative to the cursor's word) just past the last pixel
+	end_shift = cursor->shift + (u32)width * bpp;
+
+	if( end_shift <= SG_BITS_PER_WORD ){
+		//the whole span fits in the first word
+		draw_pixel_span(
+					cursor->target,
+					pattern,
+					calc_head_mask(cursor->shift) & calc_tail_mask(end_shift),
+					opaque_mask,
+					&pen_rop
+					);
+		if( end_shift == SG_BITS_PER_WORD ){
 			cursor->target++;
-			result += SG_PIXELS_PER_WORD(cursor->bmap);
+			cursor->shift = 0;
+		} else {
+			cursor->shift = end_shift;
 		}
+		return;
 	}
 
-	for(i=0; i < pixels_after_last_boundary; i++){
-		color = sg_cursor_get_pixel_no_increment(cursor);
-		if( color == 0 ){
-			return result;
-		}
-		sg_cursor_inc_x(cursor);
-		result++;
+	if( cursor->shift ){
+		draw_pixel_span(cursor->target++, pattern, calc_head_mask(cursor->shift), opaque_mask, &pen_rop);
+		end_shift -= SG_BITS_PER_WORD;
 	}
 
-	return width;
+	aligned_words = end_shift / SG_BITS_PER_WORD;
+	sg_fill_words(cursor->target, aligned_words, pattern, opaque_mask, pen_rop.rop);
+	cursor->target += aligned_words;
+
+	cursor->shift = end_shift % SG_BITS_PER_WORD;
+	if( cursor->shift ){
+		draw_pixel_span(cursor->target, pattern, calc_tail_mask(cursor->shift), opaque_mask, &pen_rop);
+	}
 }
 
-void sg_cursor_draw_pattern(sg_cursor_t * cursor, sg_size_t width, sg_bmap_data_t pattern){
-	sg_size_t pixels_until_first_boundary;
-	sg_size_t pixels_after_last_boundary;
-	sg_size_t aligned_words;
-	sg_size_t i;
-	sg_bmap_data_t color;
-	u16 o_flags = cursor->bmap->pen.o_flags;
+void sg_cursor_draw_dash(sg_cursor_t * cursor, sg_size_t width, u32 dash, u32 phase){
+	CURSOR_KERNEL(cursor->bmap, draw_dash)(cursor, width, dash, phase);
+}
+
+/*
+ * Draws the pen's pattern on a row with the dash bits as the write mask
+ *
+ * The dash is rotated so that bit n lines up with pixel n of the word at
+ * the cursor. Each word's mask is that rotated dash spread to bpp bits
+ * per pixel, so every word is read and written once no matter how short
+ * the dashes are. For 1 bit per pixel the mask is the same for each word.
+ *
+ */
+void draw_dash_kernel(sg_cursor_t * cursor, sg_size_t width, u32 dash, u32 phase, u32 bits_per_pixel){
+	const u32 bpp = kernel_bpp(cursor->bmap, bits_per_pixel);
+	sg_pen_rop_t pen_rop;
+	sg_bmap_data_t opaque_mask;
+	sg_bmap_data_t mask;
+	u32 end_shift;
+	u32 bits;
+
+	if( width == 0 ){
+		return;
+	}
 
-	//calculate the pixels around the boundaries
-	pixels_until_first_boundary = calc_pixels_until_first_boundary(cursor, width, cursor->shift);
-	aligned_words = calc_aligned_words(cursor, width, pixels_until_first_boundary);
-	pixels_after_last_boundary = calc_pixels_after_last_boundary(cursor, width, pixels_until_first_boundary, aligned_words);
+	sg_pen_rop_init(&pen_rop, cursor->bmap);
+	opaque_mask = calc_transparent_opaque_mask(bpp, pen_rop.pattern, &pen_rop);
+
+	bits = rotate_dash(dash, phase - cursor->shift / bpp);
+	end_shift = cursor->shift + (u32)width * bpp;
+	mask = calc_head_mask(cursor->shift);
+	while( end_shift > SG_BITS_PER_WORD ){
+		draw_pixel_span(cursor->target++, pen_rop.pattern, mask & calc_dash_mask(bpp, bits), opaque_mask, &pen_rop);
+		bits = rotate_dash(bits, SG_BITS_PER_WORD / bpp);
+		end_shift -= SG_BITS_PER_WORD;
+		mask = (sg_bmap_data_t)-1;
+	}
 
-	//this loop could be done in one operation
-	for(i=0; i < pixels_until_first_boundary; i++){
-		color = (pattern >> cursor->shift);
-		draw_pixel(cursor, color);
-		sg_cursor_inc_x(cursor);
+	draw_pixel_span(cursor->target, pen_rop.pattern, mask & calc_tail_mask(end_shift) & calc_dash_mask(bpp, bits), opaque_mask, &pen_rop);
+	if( end_shift == SG_BITS_PER_WORD ){
+		cursor->target++;
+		cursor->shift = 0;
+	} else {
+		cursor->shift = end_shift;
 	}
+}
+
+//spreads bit n of bits to the bpp bits of pixel n in a word
+sg_bmap_data_t calc_dash_mask(u32 bpp, u32 bits){
+	const sg_bmap_data_t pixel_mask = ((sg_bmap_data_t)1 << bpp) - 1;
+	sg_bmap_data_t mask = 0;
+	u32 i;
 
-	for(i=0; i < aligned_words; i++){
-		draw_pixel_group(cursor->target++, pattern, 0, o_flags);
+	if( bpp == 1 ){
+		return bits;
 	}
 
-	//this loop could also be done in one operation
-	for(i=0; i < pixels_after_last_boundary; i++){
-		color = (pattern >> cursor->shift);
-		draw_pixel(cursor, color);
-		sg_cursor_inc_x(cursor);
+	for(i=0; i < SG_BITS_PER_WORD / bpp; i++){
+		if( (bits >> i) & 1 ){
+			mask |= pixel_mask << (i * bpp);
+		}
 	}
+	return mask;
 }
 
 
@@ -296,65 +519,20 @@ void sg_cursor_draw_cursor(
 		const sg_cursor_t * src_cursor,
 		sg_size_t width
 		){
-	sg_size_t pixels_until_first_boundary;
-	sg_size_t pixels_after_last_boundary;
-	sg_size_t aligned_words;
-
 	sg_size_t i;
-	sg_bmap_data_t intermediate_value;
-	sg_bmap_data_t mask;
 	sg_cursor_t shift_cursor;
+	sg_cursor_expand_t expand;
 
-	u16 o_flags = dest_cursor->bmap->pen.o_flags;
-
-	sg_cursor_copy(&shift_cursor, src_cursor);
-
-	if( (dest_cursor->bmap->bits_per_pixel == src_cursor->bmap->bits_per_pixel) &&
-			((o_flags & SG_PEN_FLAG_IS_ZERO_TRANSPARENT) == 0)){
-
-		//calculate the pixels around boundaries
-		pixels_until_first_boundary = calc_pixels_until_first_boundary(src_cursor, width, shift_cursor.shift);
-		aligned_words = calc_aligned_words(src_cursor, width, pixels_until_first_boundary);
-		pixels_after_last_boundary = calc_pixels_after_last_boundary(src_cursor, width, pixels_until_first_boundary, aligned_words);
-
-		for(i=0; i < pixels_until_first_boundary; i++){
-			copy_pixel(dest_cursor, &shift_cursor);
-		}
-
-		//now handle all the words that are aligned
-		for(i=0; i < aligned_words; i++){
-
-			intermediate_value = *(shift_cursor.target);
-
-			//shift into the dest area
-			mask = (1<<dest_cursor->shift)-1;
-			draw_pixel_group(
-						dest_cursor->target,
-						((intermediate_value) << dest_cursor->shift),
-						mask,
-						o_flags
-						);
-
-			if( mask != 0 ){ //if mask is zero, then this copy is aligned -- no need for a second operation
-				draw_pixel_group(
-							dest_cursor->target+1,
-							(intermediate_value >> (SG_BITS_PER_WORD - dest_cursor->shift)),
-							~mask,
-							o_flags
-							);
-			}
-
-			dest_cursor->target++;
-			shift_cursor.target++;
-		}
-
-
-		//copy the pixels past the boundary
-		for(i=0; i < pixels_after_last_boundary; i++){
-			copy_pixel(dest_cursor, &shift_cursor);
-		}
+	if( width == 0 ){
+		return;
+	}
 
+	if( dest_cursor->bmap->bits_per_pixel == src_cursor->bmap->bits_per_pixel ){
+		CURSOR_KERNEL(dest_cursor->bmap, draw_cursor)(dest_cursor, src_cursor, width);
+	} else if( sg_cursor_expand_init(&expand, dest_cursor->bmap, src_cursor->bmap) == 0 ){
+		sg_cursor_draw_cursor_expand(dest_cursor, src_cursor, width, &expand);
 	} else {
+		sg_cursor_copy(&shift_cursor, src_cursor);
 		for(i=0; i < width; i++){
 			copy_pixel(dest_cursor, &shift_cursor);
 		}
@@ -362,210 +540,568 @@ void sg_cursor_draw_cursor(
 
 }
 
-void sg_cursor_shift_right(sg_cursor_t * cursor, sg_size_t shift_width, sg_size_t shift_distance){
-	sg_size_t pixels_until_first_boundary;
-	sg_size_t pixels_after_last_boundary;
-	sg_size_t aligned_words;
-
-	sg_size_t i;
-	sg_cursor_t shift_cursor;
-	sg_cursor_t dest_cursor;
+/*
+ * Copies width pixels from src_cursor to dest_cursor (same bits per pixel)
+ *
+ * Source words are fed through a two word shift register so that each source
+ * word is read once and each destination word (including the partial words
+ * at either end) is written once regardless of how the source and destination
+ * bit offsets line up. Source words outside of the copied pixels are never read.
+ *
+ * In zero transparent mode, the zero pixels of each shifted source word are
+ * masked out so transparent blits also run one word at a time.
+ *
+ */
+void draw_cursor_kernel(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, u32 bits_per_pixel){
+	const u32 bpp = kernel_bpp(dest_cursor->bmap, bits_per_pixel);
+	const sg_bmap_data_t * src = src_cursor->target;
+	sg_bmap_data_t * dest = dest_cursor->target;
+	sg_pen_rop_t pen_rop;
+	u32 bits = (u32)width * bpp;
+	u32 dest_end = dest_cursor->shift + bits;
+	u32 dest_words = (dest_end + SG_BITS_PER_WORD - 1) / SG_BITS_PER_WORD;
+	s32 src_last = (src_cursor->shift + bits - 1) / SG_BITS_PER_WORD;
+	s32 src_index;
+	s32 delta;
+	u32 funnel;
+	u32 k;
+	u32 body_words;
+	sg_bmap_data_t low;
+	sg_bmap_data_t high;
 	sg_bmap_data_t value;
 	sg_bmap_data_t mask;
-	sg_size_t operating_width;
 
-	//calculate the pixels around boundaries
-	pixels_until_first_boundary = calc_pixels_until_first_boundary(cursor, shift_width, cursor->shift);
-	aligned_words = calc_aligned_words(cursor, shift_width, pixels_until_first_boundary);
-	pixels_after_last_boundary = calc_pixels_after_last_boundary(cursor, shift_width, pixels_until_first_boundary, aligned_words);
+	sg_pen_rop_init(&pen_rop, dest_cursor->bmap);
 
-	sg_cursor_copy(&shift_cursor, cursor);
+	//source bit that lines up with bit 0 of the first destination word
+	delta = (s32)src_cursor->shift - (s32)dest_cursor->shift;
+	if( delta < 0 ){
+		src_index = -1;
+		funnel = delta + SG_BITS_PER_WORD;
+		low = 0; //these bits are masked in the destination
+	} else {
+		src_index = 0;
+		funnel = delta;
+		low = src[0];
+	}
 
+	//first destination word (may also be the last)
+	src_index++;
+	high = (src_index <= src_last) ? src[src_index] : 0;
+	value = funnel_shift(low, high, funnel);
+	mask = calc_head_mask(dest_cursor->shift);
+	if( dest_words == 1 ){
+		mask &= calc_tail_mask(dest_end);
+	}
+	draw_pixel_span(dest, value, mask, calc_transparent_opaque_mask(bpp, value, &pen_rop), &pen_rop);
+	low = high;
+
+	if( dest_words > 1 ){
+		//whole destination words -- every source word read here is in range
+		body_words = dest_words - 2;
+		if( pen_rop.rop == SG_ROP_AND_INVERTED ){
+			for(k=1; k <= body_words; k++){
+				high = src[++src_index];
+				dest[k] &= ~funnel_shift(low, high, funnel);
+				low = high;
+			}
+		} else if( pen_rop.rop == SG_ROP_XOR ){
+			for(k=1; k <= body_words; k++){
+				high = src[++src_index];
+				dest[k] ^= funnel_shift(low, high, funnel);
+				low = high;
+			}
+		} else if( pen_rop.rop == SG_ROP_OR ){
+			for(k=1; k <= body_words; k++){
+				high = src[++src_index];
+				dest[k] |= funnel_shift(low, high, funnel);
+				low = high;
+			}
+		} else if( (pen_rop.rop == SG_ROP_COPY) && pen_rop.is_zero_transparent ){
+			for(k=1; k <= body_words; k++){
+				high = src[++src_index];
+				value = funnel_shift(low, high, funnel);
+				dest[k] = (dest[k] & ~calc_opaque_mask(bpp, value)) | value;
+				low = high;
+			}
+		} else if( pen_rop.rop == SG_ROP_COPY ){
+			for(k=1; k <= body_words; k++){
+				high = src[++src_index];
+				dest[k] = funnel_shift(low, high, funnel);
+				low = high;
+			}
+		} else {
+			//any of the other raster operations
+			for(k=1; k <= body_words; k++){
+				high = src[++src_index];
+				value = funnel_shift(low, high, funnel);
+				mask = calc_transparent_opaque_mask(bpp, value, &pen_rop);
+				dest[k] = (dest[k] & ~mask) | (sg_calc_rop(pen_rop.rop, value, dest[k]) & mask);
+				low = high;
+			}
+		}
 
-	for(i=0; i < shift_distance; i++){
-		sg_cursor_inc_x(cursor);
+		//last destination word
+		src_index++;
+		high = (src_index <= src_last) ? src[src_index] : 0;
+		value = funnel_shift(low, high, funnel);
+		draw_pixel_span(
+					dest + dest_words - 1,
+					value,
+					calc_tail_mask(dest_end - (dest_words - 1)*SG_BITS_PER_WORD),
+					calc_transparent_opaque_mask(bpp, value, &pen_rop),
+					&pen_rop
+					);
 	}
 
-	sg_cursor_copy(&dest_cursor, cursor);
+	dest_cursor->target += dest_end / SG_BITS_PER_WORD;
+	dest_cursor->shift = dest_end % SG_BITS_PER_WORD;
+}
 
-	for(i=0; i < shift_width; i++){
-		sg_cursor_inc_x(&shift_cursor);
-		sg_cursor_inc_x(&dest_cursor);
+int sg_cursor_expand_init(sg_cursor_expand_t * expand, const sg_bmap_t * dest, const sg_bmap_t * src){
+	u32 src_bpp = src->bits_per_pixel;
+	u32 dest_bpp = dest->bits_per_pixel;
+	u32 pixels;
+	u32 i;
+	u32 j;
+	sg_color_t color;
+
+	//source pixels must fit in a nibble and destination pixels must be larger
+	if( (src_bpp == 0) || (src_bpp > 4) || (dest_bpp <= src_bpp) || (dest_bpp > 16) ){
+		return -1;
 	}
 
-	if( pixels_after_last_boundary > 0 ){
-
-		shift_cursor.shift = 0;
-		for(i=0; i < pixels_after_last_boundary; i++){
-			sg_cursor_dec_x(&dest_cursor);
-		}
+	//number of source pixels that are expanded by each table entry
+	pixels = 4 / src_bpp;
+	if( pixels * dest_bpp > SG_BITS_PER_WORD ){
+		pixels = SG_BITS_PER_WORD / dest_bpp;
+	}
 
-		operating_width = pixels_after_last_boundary;
+	expand->src_bits_per_pixel = src_bpp;
+	expand->dest_bits_per_pixel = dest_bpp;
+	expand->src_bits = pixels * src_bpp;
+	expand->dest_bits = pixels * dest_bpp;
 
-		if( operating_width > shift_width ){
-			operating_width = shift_width;
+	for(i=0; i < (1u << expand->src_bits); i++){
+		expand->table[i] = 0;
+		for(j=0; j < pixels; j++){
+			color = expand_color(dest, (i >> (j*src_bpp)) & ((1<<src_bpp)-1));
+			expand->table[i] |= (color & ((1<<dest_bpp)-1)) << (j*dest_bpp);
 		}
+	}
 
-		mask = ((1<<operating_width*SG_BITS_PER_PIXEL_VALUE(cursor->bmap)) - 1);
-		value = (*shift_cursor.target) & mask;
-
-		*shift_cursor.target &= ~(mask);
+	return 0;
+}
 
-		//now put mask and value in dest
-		(*dest_cursor.target) &= ~(mask << dest_cursor.shift);
-		(*dest_cursor.target) |= (value << dest_cursor.shift);
+/*
+ * Copies width pixels from src_cursor to dest_cursor where the destination has more
+ * bits per pixel than the source
+ *
+ * Source words are aligned to the first pixel, each group of source bits is
+ * expanded through the lookup table and the expanded words are shifted into
+ * place in the destination. Each destination word is written once.
+ *
+ */
+void sg_cursor_draw_cursor_expand(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, const sg_cursor_expand_t * expand){
+	const sg_bmap_data_t * src = src_cursor->target;
+	sg_bmap_data_t * dest = dest_cursor->target;
+	const u32 bpp = expand->dest_bits_per_pixel;
+	u32 dest_shift = dest_cursor->shift;
+	u32 dest_end = dest_shift + (u32)width * expand->dest_bits_per_pixel;
+	u32 dest_words = (dest_end + SG_BITS_PER_WORD - 1) / SG_BITS_PER_WORD;
+	u32 expanded_words = ((u32)width * expand->dest_bits_per_pixel + SG_BITS_PER_WORD - 1) / SG_BITS_PER_WORD;
+	u32 src_last = (src_cursor->shift + (u32)width * expand->src_bits_per_pixel - 1) / SG_BITS_PER_WORD;
+	u32 ratio = expand->dest_bits_per_pixel / expand->src_bits_per_pixel;
+	u32 src_bits_per_word = SG_BITS_PER_WORD / ratio;
+	u32 src_bits = expand->src_bits;
+	u32 dest_bits = expand->dest_bits;
+	u32 groups = SG_BITS_PER_WORD / dest_bits;
+	u32 index_mask = (1<<src_bits) - 1;
+	u32 src_index = 0;
+	u32 part = ratio;
+	u32 k;
+	u32 g;
+	sg_bmap_data_t table[16];
+	sg_bmap_data_t src_word = 0;
+	sg_bmap_data_t bits;
+	sg_bmap_data_t expanded;
+	sg_bmap_data_t previous = 0;
+	sg_bmap_data_t value;
+	sg_bmap_data_t mask;
+	sg_pen_rop_t pen_rop;
 
-		if( dest_cursor.shift > 0 ){
-			*(dest_cursor.target+1) &= ~(mask >> (SG_BITS_PER_WORD - dest_cursor.shift));
-			*(dest_cursor.target+1) |= (value >> (SG_BITS_PER_WORD - dest_cursor.shift));
-		}
+	if( width == 0 ){
+		return;
 	}
 
-	shift_cursor.target--;
-	dest_cursor.target--;
+	sg_pen_rop_init(&pen_rop, dest_cursor->bmap);
 
-	for(i=0; i < aligned_words; i++){
+	//local copy so that writes to dest can't alias the table
+	memcpy(table, expand->table, sizeof(table));
 
-		mask = (u32)-1;
-		value = *shift_cursor.target;
+	for(k=0; k < dest_words; k++){
 
-		*shift_cursor.target = 0;
+		expanded = 0;
+		if( k < expanded_words ){
+			if( part == ratio ){
+				//load the next source word aligned to the source cursor
+				src_word = funnel_shift(
+							src[src_index],
+							(src_index + 1 <= src_last) ? src[src_index+1] : 0,
+							src_cursor->shift
+							);
+				src_index++;
+				part = 0;
+			}
+
+			bits = src_word >> (part * src_bits_per_word);
+			part++;
+			for(g=0; g < groups; g++){
+				expanded |= table[(bits >> (g*src_bits)) & index_mask] << (g*dest_bits);
+			}
+		}
 
-		//now put mask and value in dest
-		(*dest_cursor.target) &= ~(mask << dest_cursor.shift);
-		(*dest_cursor.target) |= (value << dest_cursor.shift);
+		//shift the expanded pixels into place in the destination
+		if( dest_shift ){
+			value = (expanded << dest_shift) | (previous >> (SG_BITS_PER_WORD - dest_shift));
+		} else {
+			value = expanded;
+		}
+		previous = expanded;
 
-		if( dest_cursor.shift > 0 ){
-			*(dest_cursor.target+1) &= ~(mask >> (SG_BITS_PER_WORD - dest_cursor.shift));
-			*(dest_cursor.target+1) |= (value >> (SG_BITS_PER_WORD - dest_cursor.shift));
+		mask = (sg_bmap_data_t)-1;
+		if( k == 0 ){
+			mask = calc_head_mask(dest_shift);
+		}
+		if( k == dest_words - 1 ){
+			mask &= calc_tail_mask(dest_end - k*SG_BITS_PER_WORD);
 		}
 
-		dest_cursor.target--;
-		shift_cursor.target--;
+		draw_pixel_span(dest + k, value, mask, calc_transparent_opaque_mask(bpp, value, &pen_rop), &pen_rop);
 	}
 
-	if( pixels_until_first_boundary ){
-		operating_width = pixels_until_first_boundary;
+	dest_cursor->target += dest_end / SG_BITS_PER_WORD;
+	dest_cursor->shift = dest_end % SG_BITS_PER_WORD;
+}
 
-		dest_cursor.target++;
-		shift_cursor.target++;
+/*
+ * Combines pattern, width pixels from src_cursor and the destination using
+ * the ternary raster operation rop
+ *
+ * When the bitmaps have the same bits per pixel, the source is funnel shifted
+ * into line with the destination and each destination word is read and written
+ * once. The pattern is aligned to the destination words.
+ *
+ */
+void sg_cursor_draw_cursor_rop(
+		sg_cursor_t * dest_cursor,
+		const sg_cursor_t * src_cursor,
+		sg_size_t width,
+		sg_bmap_data_t pattern,
+		u8 rop
+		){
+	const sg_bmap_data_t * src = src_cursor->target;
+	sg_bmap_data_t * dest = dest_cursor->target;
+	u32 bits = (u32)width * SG_BITS_PER_PIXEL_VALUE(dest_cursor->bmap);
+	u32 dest_end = dest_cursor->shift + bits;
+	u32 dest_words = (dest_end + SG_BITS_PER_WORD - 1) / SG_BITS_PER_WORD;
+	s32 src_last;
+	s32 src_index;
+	s32 delta;
+	u32 funnel;
+	u32 k;
+	sg_bmap_data_t low;
+	sg_bmap_data_t high;
+	sg_bmap_data_t value;
+	sg_bmap_data_t mask;
 
-		for(i=0; i < pixels_until_first_boundary; i++){
-			sg_cursor_dec_x(&shift_cursor);
-			sg_cursor_dec_x(&dest_cursor);
-		}
+	if( width == 0 ){
+		return;
+	}
 
-		mask = ((1<<operating_width*SG_BITS_PER_PIXEL_VALUE(cursor->bmap)) - 1);
-		value = (*shift_cursor.target >> shift_cursor.shift) & mask;
+	if( dest_cursor->bmap->bits_per_pixel != src_cursor->bmap->bits_per_pixel ){
+		draw_cursor_rop_pixels(dest_cursor, src_cursor, width, pattern, rop);
+		return;
+	}
 
-		*shift_cursor.target &= ~(mask << shift_cursor.shift);
+	src_last = (src_cursor->shift + bits - 1) / SG_BITS_PER_WORD;
+	delta = (s32)src_cursor->shift - (s32)dest_cursor->shift;
+	if( delta < 0 ){
+		src_index = -1;
+		funnel = delta + SG_BITS_PER_WORD;
+		low = 0; //these bits are masked in the destination
+	} else {
+		src_index = 0;
+		funnel = delta;
+		low = src[0];
+	}
 
-		//now put mask and value in dest
-		(*dest_cursor.target) &= ~(mask << dest_cursor.shift);
-		(*dest_cursor.target) |= (value << dest_cursor.shift);
+	for(k=0; k < dest_words; k++){
+		src_index++;
+		high = (src_index <= src_last) ? src[src_index] : 0;
+		value = funnel_shift(low, high, funnel);
+		low = high;
 
-		if( dest_cursor.shift > 0 ){
-			*(dest_cursor.target+1) &= ~(mask >> (SG_BITS_PER_WORD - dest_cursor.shift));
-			*(dest_cursor.target+1) |= (value >> (SG_BITS_PER_WORD - dest_cursor.shift));
+		mask = (sg_bmap_data_t)-1;
+		if( k == 0 ){
+			mask = calc_head_mask(dest_cursor->shift);
+		}
+		if( k == dest_words - 1 ){
+			mask &= calc_tail_mask(dest_end - k*SG_BITS_PER_WORD);
 		}
+
+		dest[k] = (dest[k] & ~mask) | (sg_calc_rop3(rop, pattern, value, dest[k]) & mask);
 	}
-}
 
-void sg_cursor_shift_left(sg_cursor_t * cursor, sg_size_t shift_width, sg_size_t shift_distance){
-	sg_size_t pixels_until_first_boundary;
-	sg_size_t pixels_after_last_boundary;
-	sg_size_t aligned_words;
+	dest_cursor->target += dest_end / SG_BITS_PER_WORD;
+	dest_cursor->shift = dest_end % SG_BITS_PER_WORD;
+}
 
-	sg_size_t i;
-	sg_cursor_t shift_cursor;
-	sg_cursor_t dest_cursor;
+//sg_cursor_draw_cursor_rop() for bitmaps with different bits per pixel
+void draw_cursor_rop_pixels(sg_cursor_t * dest_cursor, const sg_cursor_t * src_cursor, sg_size_t width, sg_bmap_data_t pattern, u8 rop){
+	sg_cursor_t src_pixel_cursor;
+	sg_bmap_data_t pixel_mask = SG_PIXEL_MASK(dest_cursor->bmap);
 	sg_bmap_data_t value;
 	sg_bmap_data_t mask;
-	sg_size_t operating_width;
-
-	//calculate the pixels around boundaries
-	pixels_until_first_boundary = calc_pixels_until_first_boundary(cursor, shift_width, cursor->shift);
-	aligned_words = calc_aligned_words(cursor, shift_width, pixels_until_first_boundary);
-	pixels_after_last_boundary = calc_pixels_after_last_boundary(cursor, shift_width, pixels_until_first_boundary, aligned_words);
-
-	sg_cursor_copy(&shift_cursor, cursor);
+	sg_size_t i;
 
-	for(i=0; i < shift_distance; i++){
-		sg_cursor_dec_x(cursor);
+	sg_cursor_copy(&src_pixel_cursor, src_cursor);
+	for(i=0; i < width; i++){
+		value = convert_color(dest_cursor->bmap, src_cursor->bmap, sg_cursor_get_pixel(&src_pixel_cursor));
+		value = (value & pixel_mask) << dest_cursor->shift;
+		mask = pixel_mask << dest_cursor->shift;
+		*(dest_cursor->target) = (*(dest_cursor->target) & ~mask) | (sg_calc_rop3(rop, pattern, value, *(dest_cursor->target)) & mask);
+		sg_cursor_inc_x(dest_cursor);
 	}
+}
 
-	sg_cursor_copy(&dest_cursor, cursor);
-
-	if( pixels_until_first_boundary > 0 ){
-
-		operating_width = pixels_until_first_boundary;
+/*
+ * Draws a clipped line using the pen
+ *
+ * The cursor is stepped in place so bounds are never checked per pixel.
+ * When x is the major axis, the pixels that land in the same word are
+ * collected in a mask and written with one read-modify-write.
+ *
+ */
+void sg_cursor_draw_line(sg_cursor_t * cursor, const sg_cursor_line_t * line){
+	const s32 shift_step = line->step_x * (s32)SG_BITS_PER_PIXEL_VALUE(cursor->bmap);
+	const s32 row_step = line->step_y * (s32)cursor->bmap->columns;
+	sg_pen_rop_t pen_rop;
+	sg_bmap_data_t pattern;
+	sg_bmap_data_t * target = cursor->target;
+	s32 shift = cursor->shift;
+	u32 error = line->error;
+	sg_bmap_data_t mask = 0;
+	u32 i;
+
+	sg_pen_rop_init(&pen_rop, cursor->bmap);
+	pattern = pen_rop.pattern;
+	if( (line->count == 0) || (pen_rop.is_zero_transparent && (pattern == 0)) ){
+		return;
+	}
 
-		if( operating_width > shift_width ){
-			operating_width = shift_width;
+	i = 0;
+	if( line->is_y_major == 0 ){
+		for(;;){
+			mask |= pen_rop.pixel_mask << shift;
+			if( ++i == line->count ){
+				break;
+			}
+			shift += shift_step;
+			error += line->error_step;
+			if( error >= line->error_limit ){
+				error -= line->error_limit;
+				pen_rop.draw_word(target, pattern, mask);
+				mask = 0;
+				target += row_step;
+			}
+			if( (u32)shift >= SG_BITS_PER_WORD ){
+				if( mask ){
+					pen_rop.draw_word(target, pattern, mask);
+					mask = 0;
+				}
+				if( shift < 0 ){
+					target--;
+					shift += SG_BITS_PER_WORD;
+				} else {
+					target++;
+					shift -= SG_BITS_PER_WORD;
+				}
+			}
+		}
+		pen_rop.draw_word(target, pattern, mask);
+	} else {
+		for(;;){
+			pen_rop.draw_word(target, pattern, pen_rop.pixel_mask << shift);
+			if( ++i == line->count ){
+				break;
+			}
+			target += row_step;
+			error += line->error_step;
+			if( error >= line->error_limit ){
+				error -= line->error_limit;
+				shift += shift_step;
+				if( shift < 0 ){
+					target--;
+					shift += SG_BITS_PER_WORD;
+				} else if( shift >= SG_BITS_PER_WORD ){
+					target++;
+					shift -= SG_BITS_PER_WORD;
+				}
+			}
 		}
+	}
 
-		mask = ((1<<operating_width*SG_BITS_PER_PIXEL_VALUE(cursor->bmap)) - 1);
-		value = (*shift_cursor.target >> shift_cursor.shift) & mask;
+	//the cursor is left on the last pixel of the line
+	cursor->target = target;
+	cursor->shift = shift;
+}
 
-		(*shift_cursor.target) &= ~(mask << shift_cursor.shift);
+void sg_cursor_advance(sg_cursor_t * cursor, int n){
+	s32 bits = (s32)cursor->shift + n * (s32)SG_BITS_PER_PIXEL_VALUE(cursor->bmap);
+	s32 words = floor_words(bits);
+	cursor->target += words;
+	cursor->shift = bits - words * SG_BITS_PER_WORD;
+}
 
-		//now put mask and value in dest
-		(*dest_cursor.target) &= ~(mask << dest_cursor.shift);
-		(*dest_cursor.target) |= (value << dest_cursor.shift);
+void sg_cursor_shift_right(sg_cursor_t * cursor, sg_size_t shift_width, sg_size_t shift_distance){
+	u32 bpp = SG_BITS_PER_PIXEL_VALUE(cursor->bmap);
+	s32 start = cursor->shift;
+	sg_size_t cleared = shift_distance < shift_width ? shift_distance : shift_width;
 
-		if( dest_cursor.shift > 0 ){
-			*(dest_cursor.target+1) &= ~(mask >> (SG_BITS_PER_WORD - dest_cursor.shift));
-			*(dest_cursor.target+1) |= (value >> (SG_BITS_PER_WORD - dest_cursor.shift));
-		}
+	move_bits(cursor->target, start + shift_distance*bpp, start, shift_width*bpp);
 
-		shift_cursor.target++;
-		shift_cursor.shift = 0;
+	//pixels that were moved out and not written over are cleared
+	clear_bits(cursor->target, start, cleared*bpp);
 
+	sg_cursor_advance(cursor, shift_distance);
+}
 
-		for(i=0; i < pixels_until_first_boundary; i++){
-			sg_cursor_inc_x(&dest_cursor);
-		}
+void sg_cursor_shift_left(sg_cursor_t * cursor, sg_size_t shift_width, sg_size_t shift_distance){
+	u32 bpp = SG_BITS_PER_PIXEL_VALUE(cursor->bmap);
+	s32 start = cursor->shift;
+	sg_size_t cleared = shift_distance < shift_width ? shift_distance : shift_width;
 
-	}
+	move_bits(cursor->target, start - (s32)(shift_distance*bpp), start, shift_width*bpp);
 
-	for(i=0; i < aligned_words; i++){
+	//pixels that were moved out and not written over are cleared
+	clear_bits(cursor->target, start + (shift_width - cleared)*bpp, cleared*bpp);
 
-		mask = (u32)-1;
-		value = *shift_cursor.target;
+	sg_cursor_advance(cursor, -1*(int)shift_distance);
+}
 
-		*shift_cursor.target = 0;
+/*
+ * Moves bits within a bitmap (like memmove() but with bit offsets relative to base)
+ *
+ * Destination words are built from two source words using a funnel shift.
+ * When moving to the left, words are processed from first to last and
+ * when moving to the right, from last to first so that overlapping source
+ * words are always read before they are overwritten. Each destination word
+ * is written once.
+ *
+ */
+void move_bits(sg_bmap_data_t * base, s32 dest_bit, s32 src_bit, u32 bits){
+	s32 dest_first;
+	s32 dest_last;
+	s32 src_first;
+	s32 src_last;
+	s32 offset;
+	s32 k;
+	u32 funnel;
+	u32 dest_end;
+	sg_bmap_data_t low;
+	sg_bmap_data_t high;
+	sg_bmap_data_t mask;
 
-		//now put mask and value in dest
-		(*dest_cursor.target) &= ~(mask << dest_cursor.shift);
-		(*dest_cursor.target) |= (value << dest_cursor.shift);
+	if( (bits == 0) || (dest_bit == src_bit) ){
+		return;
+	}
 
-		if( dest_cursor.shift > 0 ){
-			*(dest_cursor.target+1) &= ~(mask >> (SG_BITS_PER_WORD - dest_cursor.shift));
-			*(dest_cursor.target+1) |= (value >> (SG_BITS_PER_WORD - dest_cursor.shift));
+	dest_first = floor_words(dest_bit);
+	dest_last = floor_words(dest_bit + bits - 1);
+	src_first = floor_words(src_bit);
+	src_last = floor_words(src_bit + bits - 1);
+
+	//bit 0 of destination word k lines up with bit funnel of source word k + offset
+	offset = floor_words(src_bit - dest_bit);
+	funnel = (src_bit - dest_bit) - offset*SG_BITS_PER_WORD;
+	dest_end = dest_bit + bits - dest_last*SG_BITS_PER_WORD;
+
+	if( dest_bit < src_bit ){
+		low = read_word(base, dest_first + offset, src_first, src_last);
+		for(k = dest_first; k <= dest_last; k++){
+			high = read_word(base, k + offset + 1, src_first, src_last);
+			mask = calc_move_mask(k, dest_first, dest_last, dest_bit, dest_end);
+			base[k] = (base[k] & ~mask) | (funnel_shift(low, high, funnel) & mask);
+			low = high;
 		}
+	} else {
+		high = read_word(base, dest_last + offset + 1, src_first, src_last);
+		for(k = dest_last; k >= dest_first; k--){
+			low = read_word(base, k + offset, src_first, src_last);
+			mask = calc_move_mask(k, dest_first, dest_last, dest_bit, dest_end);
+			base[k] = (base[k] & ~mask) | (funnel_shift(low, high, funnel) & mask);
+			high = low;
+		}
+	}
+}
 
-		dest_cursor.target++;
-		shift_cursor.target++;
+//clears bits starting at start_bit (relative to base)
+void clear_bits(sg_bmap_data_t * base, s32 start_bit, u32 bits){
+	s32 first;
+	s32 last;
+	u32 end;
+
+	if( bits == 0 ){
+		return;
 	}
 
-	if( pixels_after_last_boundary > 0 ){
-		operating_width = pixels_after_last_boundary;
+	first = floor_words(start_bit);
+	last = floor_words(start_bit + bits - 1);
+	end = start_bit + bits - last*SG_BITS_PER_WORD;
 
-		mask = ((1<<operating_width*SG_BITS_PER_PIXEL_VALUE(cursor->bmap)) - 1);
-		value = (*shift_cursor.target) & mask;
+	if( first == last ){
+		base[first] &= ~(calc_head_mask(start_bit - first*SG_BITS_PER_WORD) & calc_tail_mask(end));
+		return;
+	}
 
-		*shift_cursor.target &= ~(mask);
+	base[first] &= ~calc_head_mask(start_bit - first*SG_BITS_PER_WORD);
+	sg_fill_words(base + first + 1, last - first - 1, 0, (sg_bmap_data_t)-1, SG_ROP_COPY);
+	base[last] &= ~calc_tail_mask(end);
+}
 
-		//now put mask and value in dest
-		(*dest_cursor.target) &= ~(mask << dest_cursor.shift);
-		(*dest_cursor.target) |= (value << dest_cursor.shift);
+//mask of the bits to write in destination word k of move_bits()
+sg_bmap_data_t calc_move_mask(s32 k, s32 first, s32 last, s32 dest_bit, u32 dest_end){
+	sg_bmap_data_t mask = (sg_bmap_data_t)-1;
+	if( k == first ){
+		mask = calc_head_mask(dest_bit - first*SG_BITS_PER_WORD);
+	}
+	if( k == last ){
+		mask &= calc_tail_mask(dest_end);
+	}
+	return mask;
+}
 
-		if( dest_cursor.shift > 0 ){
-			*(dest_cursor.target+1) &= ~(mask >> (SG_BITS_PER_WORD - dest_cursor.shift));
-			*(dest_cursor.target+1) |= (value >> (SG_BITS_PER_WORD - dest_cursor.shift));
-		}
+//reads word index of base or zero if index is outside of first to last
+sg_bmap_data_t read_word(const sg_bmap_data_t * base, s32 index, s32 first, s32 last){
+	if( (index < first) || (index > last) ){
+		return 0;
+	}
+	return base[index];
+}
 
+//number of whole words in bits (rounded toward negative infinity)
+s32 floor_words(s32 bits){
+	if( bits < 0 ){
+		return -((SG_BITS_PER_WORD - 1 - bits) / SG_BITS_PER_WORD);
 	}
+	return bits / SG_BITS_PER_WORD;
+}
+
+//rotates dash right by n bits (bit n becomes bit zero)
+u32 rotate_dash(u32 dash, u32 n){
+	n &= 31;
+	return n ? (dash >> n) | (dash << (32 - n)) : dash;
 }
 
 sg_color_t get_pixel(const sg_cursor_t * cursor){
@@ -586,94 +1122,188 @@ void sg_cursor_inc_x(sg_cursor_t * cursor){
 
 
 void copy_pixel(sg_cursor_t * dest, sg_cursor_t * src){
+	sg_color_t color = convert_color(dest->bmap, src->bmap, sg_cursor_get_pixel(src));
+	draw_pixel(dest, color);
+	sg_cursor_inc_x(dest);
+}
 
-	sg_color_t color = sg_cursor_get_pixel(src);
-	if( src->bmap->bits_per_pixel > dest->bmap->bits_per_pixel ){
+//converts color from a pixel in src to a pixel in dest
+sg_color_t convert_color(const sg_bmap_t * dest, const sg_bmap_t * src, sg_color_t color){
+	if( src->bits_per_pixel > dest->bits_per_pixel ){
 		//take only the most significant bits
-		color = (color >> (src->bmap->bits_per_pixel - dest->bmap->bits_per_pixel));
-	} else if( src->bmap->bits_per_pixel < dest->bmap->bits_per_pixel ){
-		//lookup the color from a palette
-		//convert from 1,2,4,8 to 2,4,8,16,32 using a palette if a palette is available
-		if( color ){
-			color = color + dest->bmap->pen.color - 1;
-		}
+		return color >> (src->bits_per_pixel - dest->bits_per_pixel);
+	} else if( src->bits_per_pixel < dest->bits_per_pixel ){
+		return expand_color(dest, color);
 	}
-
-	draw_pixel(dest, color);
-	sg_cursor_inc_x(dest);
+	return color;
 }
 
-sg_size_t calc_pixels_until_first_boundary(const sg_cursor_t * cursor, sg_size_t w, sg_size_t shift){
-	sg_size_t pixels_until_first_boundary;
+//converts a color from a bitmap with fewer bits per pixel to a color in bmap
+sg_color_t expand_color(const sg_bmap_t * bmap, sg_color_t color){
+	if( bmap->palette ){
+		return bmap->palette->colors[color & bmap->palette->mask];
+	}
 
-	pixels_until_first_boundary = (SG_BITS_PER_WORD - shift)/SG_BITS_PER_PIXEL_VALUE(cursor->bmap);
+	//without a palette, non-zero colors are offset by the pen color
+	if( color ){
+		return color + bmap->pen.color - 1;
+	}
+	return 0;
+}
 
-	if( pixels_until_first_boundary == SG_PIXELS_PER_WORD(cursor->bmap) ){
-		pixels_until_first_boundary = 0;
+//reads the pixel at cursor and increments the cursor
+sg_color_t get_pixel_kernel(sg_cursor_t * cursor, u32 bits_per_pixel){
+	const u32 bpp = kernel_bpp(cursor->bmap, bits_per_pixel);
+	sg_color_t color = (*(cursor->target) >> cursor->shift) & ((1<<bpp) - 1);
+	cursor->shift += bpp;
+	if( cursor->shift == SG_BITS_PER_WORD ){
+		cursor->target++;
+		cursor->shift = 0;
 	}
+	return color;
+}
 
-	if( pixels_until_first_boundary > w ){
-		pixels_until_first_boundary = w;
+//draws color at cursor and increments the cursor
+void draw_pixel_kernel(sg_cursor_t * cursor, sg_color_t color, u32 bits_per_pixel){
+	const u32 bpp = kernel_bpp(cursor->bmap, bits_per_pixel);
+	sg_bmap_data_t pixel_mask = (((sg_bmap_data_t)1 << bpp) - 1) << cursor->shift;
+	sg_bmap_data_t data = (color << cursor->shift) & pixel_mask;
+	sg_pen_rop_t pen_rop;
+
+	sg_pen_rop_init(&pen_rop, cursor->bmap);
+	if( data || (pen_rop.is_zero_transparent == 0) ){
+		pen_rop.draw_word(cursor->target, data, pixel_mask);
 	}
 
-	return pixels_until_first_boundary;
+	cursor->shift += bpp;
+	if( cursor->shift == SG_BITS_PER_WORD ){
+		cursor->target++;
+		cursor->shift = 0;
+	}
 }
 
-sg_size_t calc_aligned_words(const sg_cursor_t * cursor, sg_size_t w, sg_size_t pixels_until_first_boundary){
-	return (w - pixels_until_first_boundary) / SG_PIXELS_PER_WORD(cursor->bmap);
+void draw_pixel(const sg_cursor_t * cursor, sg_color_t color){
+	sg_pen_rop_t pen_rop;
+	sg_bmap_data_t data;
+
+	sg_pen_rop_init(&pen_rop, cursor->bmap);
+	data = (color & pen_rop.pixel_mask) << cursor->shift;
+	//zero pixels are ignored in zero transparent mode
+	if( data || (pen_rop.is_zero_transparent == 0) ){
+		pen_rop.draw_word(cursor->target, data, pen_rop.pixel_mask << cursor->shift);
+	}
 }
 
-sg_size_t calc_pixels_after_last_boundary(const sg_cursor_t * cursor, sg_size_t w, sg_size_t pixels_until_first_boundary, sg_size_t aligned_words){
-	return w - pixels_until_first_boundary - aligned_words * SG_PIXELS_PER_WORD(cursor->bmap);
-}
+void sg_pen_rop_init(sg_pen_rop_t * pen_rop, const sg_bmap_t * bmap){
+	u16 o_flags = bmap->pen.o_flags;
 
-void draw_pixel(const sg_cursor_t * cursor, sg_color_t color){
-	u16 o_flags = cursor->bmap->pen.o_flags;
-	sg_bmap_data_t data = (color & SG_PIXEL_MASK(cursor->bmap)) << cursor->shift;
-	if( o_flags & SG_PEN_FLAG_IS_ERASE ){
-		//clear color bits
-		*(cursor->target) &= ~data;
+	pen_rop->pixel_mask = SG_PIXEL_MASK(bmap);
+	pen_rop->pattern = create_pattern(bmap, bmap->pen.color);
+
+	if( o_flags & SG_PEN_FLAG_IS_ROP ){
+		pen_rop->rop = bmap->pen.rop & 0x0f;
+	} else if( o_flags & SG_PEN_FLAG_IS_ERASE ){
+		pen_rop->rop = SG_ROP_AND_INVERTED;
 	} else if( o_flags & SG_PEN_FLAG_IS_INVERT ){
-		//XOR color bits
-		*(cursor->target) ^= data;
+		pen_rop->rop = SG_ROP_XOR;
 	} else if( o_flags & SG_PEN_FLAG_IS_BLEND ){
-		//OR color bits
-		*(cursor->target) |= data;
-	} else if( o_flags & SG_PEN_FLAG_IS_ZERO_TRANSPARENT ){
-		//ignore data if it is zero
-		if( data ){
-			*(cursor->target) &= ~(SG_PIXEL_MASK(cursor->bmap) << cursor->shift);
-			*(cursor->target) |= data;
-		}
+		pen_rop->rop = SG_ROP_OR;
 	} else {
-		//Assign color bits
-		*(cursor->target) &= ~(SG_PIXEL_MASK(cursor->bmap) << cursor->shift);
-		*(cursor->target) |= data;
+		pen_rop->rop = SG_ROP_COPY;
+	}
+	pen_rop->draw_word = rop_functions[pen_rop->rop];
+
+	//zero pixels only need to be masked if a zero pattern changes the destination
+	pen_rop->is_zero_transparent = 0;
+	if( (o_flags & SG_PEN_FLAG_IS_ZERO_TRANSPARENT) && ((pen_rop->rop & 0x03) != 0x02) ){
+		pen_rop->is_zero_transparent = 1;
 	}
 }
 
+//combines two consecutive source words into the word that starts funnel bits into low
+sg_bmap_data_t funnel_shift(sg_bmap_data_t low, sg_bmap_data_t high, u32 funnel){
+	if( funnel ){
+		return (low >> funnel) | (high << (SG_BITS_PER_WORD - funnel));
+	}
+	return low;
+}
 
-void draw_pixel_group(sg_bmap_data_t * word, sg_bmap_data_t pattern, sg_bmap_data_t mask, u16 o_flags){
-	if( o_flags & SG_PEN_FLAG_IS_ERASE ){
-		*word &= ~pattern;
-	} else if( o_flags & SG_PEN_FLAG_IS_INVERT ){
-		*word ^= pattern;
-	} else if( o_flags & SG_PEN_FLAG_IS_BLEND ){
-		*word |= pattern;
-	} else {
-		*word &= mask;
-		*word |= pattern;
+//draws the pixels of pattern selected by span_mask with a single read-modify-write
+void draw_pixel_span(sg_bmap_data_t * word, sg_bmap_data_t pattern, sg_bmap_data_t span_mask, sg_bmap_data_t opaque_mask, const sg_pen_rop_t * pen_rop){
+	pen_rop->draw_word(word, pattern, span_mask & opaque_mask);
+}
+
+//mask of bits from shift to the end of the word (shift is less than SG_BITS_PER_WORD)
+sg_bmap_data_t calc_head_mask(u32 shift){
+	return (sg_bmap_data_t)-1 << shift;
+}
+
+//mask of bits from the start of the word up to (not including) bits
+sg_bmap_data_t calc_tail_mask(u32 bits){
+	if( bits >= SG_BITS_PER_WORD ){
+		return (sg_bmap_data_t)-1;
 	}
+	return ((sg_bmap_data_t)1 << bits) - 1;
 }
 
-sg_bmap_data_t create_pattern(const sg_bmap_t * bmap, sg_color_t color){
-	sg_bmap_data_t pattern;
-	sg_size_t i;
+/*
+ * Mask of the pixels in pattern that are not zero
+ *
+ * Each pixel's bits are OR-folded down into its least significant bit
+ * (all pixels in the word at once). The least significant bits are then
+ * isolated and multiplied by the pixel mask to widen them back out
+ * to full pixels.
+ *
+ */
+sg_bmap_data_t calc_opaque_mask(u32 bpp, sg_bmap_data_t pattern){
+	switch( bpp ){
+	case 1:
+		return pattern;
+	case 2:
+		pattern |= pattern >> 1;
+		return (pattern & 0x55555555) * 0x3;
+	case 4:
+		pattern |= pattern >> 1;
+		pattern |= pattern >> 2;
+		return (pattern & 0x11111111) * 0xf;
+	case 8:
+		pattern |= pattern >> 1;
+		pattern |= pattern >> 2;
+		pattern |= pattern >> 4;
+		return (pattern & 0x01010101) * 0xff;
+	case 16:
+		pattern |= pattern >> 1;
+		pattern |= pattern >> 2;
+		pattern |= pattern >> 4;
+		pattern |= pattern >> 8;
+		return (pattern & 0x00010001) * 0xffff;
+	}
+	return (sg_bmap_data_t)-1;
+}
 
-	pattern = 0;
-	for(i=0; i < SG_BITS_PER_WORD; i+=SG_BITS_PER_PIXEL_VALUE(bmap)){
-		pattern |= ((color & SG_PIXEL_MASK(bmap)) << i);
+//opaque mask to use with draw_pixel_span() for the pen mode
+sg_bmap_data_t calc_transparent_opaque_mask(u32 bpp, sg_bmap_data_t pattern, const sg_pen_rop_t * pen_rop){
+	if( pen_rop->is_zero_transparent ){
+		return calc_opaque_mask(bpp, pattern);
+	}
+	return (sg_bmap_data_t)-1;
+}
+
+//bits per pixel for a kernel (zero means use the bitmap's value)
+u32 kernel_bpp(const sg_bmap_t * bmap, u32 bits_per_pixel){
+	if( bits_per_pixel ){
+		return bits_per_pixel;
+	}
+	return SG_BITS_PER_PIXEL_VALUE(bmap);
+}
+
+//repeats color across a word (multiplying by 0x...0101 with a period of bits per pixel)
+sg_bmap_data_t create_pattern(const sg_bmap_t * bmap, sg_color_t color){
+	sg_bmap_data_t pixel_mask = SG_PIXEL_MASK(bmap);
+	if( pixel_mask == 0 ){
+		//pixels fill the whole word
+		return color;
 	}
-	return pattern;
+	return (color & pixel_mask) * ((sg_bmap_data_t)-1 / pixel_mask);
 }
 
@@ -7,11 +7,258 @@
 
 static inline int abs_value(int x){  if( x < 0 ){ return x*-1; } return x; }
 
+//cursor that is carried from one segment of a polyline to the next
+typedef struct {
+	sg_cursor_t cursor;
+	sg_point_t position /*! Pixel that the cursor is on */;
+	u8 is_set /*! Non-zero if the cursor is on position */;
+} line_cursor_t;
+
+//one segment of a thick line (see draw_thick_polyline())
+typedef struct {
+	sg_point_t start;
+	s64 dx;
+	s64 dy;
+	s64 length_squared;
+	s64 limit /*! Thickness times the length (limit for twice the cross product) */;
+	s64 extend_start /*! Square cap extension at the start */;
+	s64 extend_end /*! Square cap extension at the end */;
+	s32 y_min;
+	s32 y_max;
+} thick_segment_t;
+
+//points of a thick polyline and how its ends are drawn (see draw_thick_polyline())
+typedef struct {
+	const sg_point_t * points;
+	u32 count;
+	sg_size_t thickness;
+	u16 o_flags;
+	u32 drawn /*! Points at the start that an earlier call drew along with the segments and joints between them */;
+	u8 is_closed;
+	u8 is_more /*! Non-zero if the chain continues past its last point (so the last point is a joint) */;
+} thick_chain_t;
+
+//thick polylines are rasterized this many segments at a time
+#define DRAW_THICK_SEGMENTS 8
+
+//bounding boxes kept for the batches of a thick polyline (see thick_boxes_t)
+#define DRAW_THICK_BOXES 32
+
+//elements drawn before a batch that can be listed as near it (see thick_covered_t)
+#define DRAW_THICK_COVERED 32
+
+//bounding boxes (grown by the thickness) of the batches of a thick polyline that have been drawn
+typedef struct {
+	sg_region_t bounds[DRAW_THICK_BOXES];
+	u32 start /*! First point of the first batch */;
+	u32 batches /*! Batches in each box (doubles each time the boxes run out) */;
+	u32 count /*! Batches that have been added */;
+} thick_boxes_t;
+
+//discs (even) and segments (odd) that were drawn before a batch and are near it (see draw_thick_row())
+typedef struct {
+	const thick_boxes_t * boxes;
+	u32 limit /*! Elements before this one were drawn before the batch */;
+	u32 history /*! Elements before this one were drawn by an earlier call */;
+	u32 box_mask /*! Boxes that overlap the batch */;
+	u32 count /*! Entries in element (DRAW_THICK_COVERED + 1 if they didn't fit) */;
+	u32 element[DRAW_THICK_COVERED];
+} thick_covered_t;
+
+/*
+ * Midpoint ellipse walk
+ *
+ * Steps through the rows of an ellipse and keeps the half width of the
+ * current row. A pixel is inside if its center is inside the ellipse with
+ * radii rx + 1/2 and ry + 1/2. The error terms are updated with additions
+ * only so the cost of each request is the distance from the last one.
+ *
+ */
+typedef struct {
+	s32 rx;
+	s32 ry;
+	s32 row /*! Current row (distance from the center) */;
+	s32 x /*! Half width of the current row */;
+	u64 test /*! 4*(2*ry+1)^2*(x+1)^2 -- x+1 is inside if this is at most threshold */;
+	u64 threshold /*! (2*rx+1)^2*((2*ry+1)^2 - 4*row^2) */;
+} ellipse_t;
+
+//part of an ellipse between two angles (see sg_draw_arc())
+typedef struct {
+	s64 start_x;
+	s64 start_y;
+	s64 end_x;
+	s64 end_y;
+	s64 scale_x /*! Scales x offsets so the angles are parametric */;
+	s64 scale_y /*! Scales y offsets so the angles are parametric */;
+	u8 is_full;
+	u8 is_reflex /*! Non-zero if the sector is more than half of the ellipse */;
+} arc_sector_t;
+
+//fraction bits used for stepping bezier curves
+#define DRAW_BEZIER_FRACTION_BITS 32
+//a curve is flattened to at most this many segments
+#define DRAW_BEZIER_MAX_SEGMENTS 1024
+
+//rectangle with rounded corners (see sg_draw_round_rect())
+typedef struct {
+	s32 left;
+	s32 top;
+	s32 right;
+	s32 bottom;
+	s32 radius[4] /*! Top left, top right, bottom right and bottom left */;
+	ellipse_t corner[4];
+} round_rect_t;
+
+/*
+ * Walks the rows of a line from its top point to its bottom point
+ *
+ * For each row, first and last are the offsets (in the direction of
+ * step_x) of the leftmost and rightmost pixels that a thin line from
+ * the top point to the bottom point draws on that row. The offsets are
+ * kept as a quotient and remainder so each row only needs additions.
+ *
+ */
+typedef struct {
+	s32 x /*! x of the top point */;
+	s32 y /*! Current row */;
+	s32 y_end /*! Row of the bottom point */;
+	s32 step_x /*! 1 or -1 */;
+	u32 length /*! Distance along x */;
+	u32 first;
+	u32 last;
+	u32 quotient /*! Offset where the next row starts (or the next offset if the edge is steep) */;
+	u32 remainder;
+	u32 quotient_step;
+	u32 remainder_step;
+	u32 divisor;
+	u8 is_steep /*! Non-zero if the edge has one pixel per row */;
+} edge_walker_t;
+
+//one side of a convex polygon from the top vertex to the bottom vertex
+typedef struct {
+	edge_walker_t edge;
+	u32 point /*! Index of the point at the bottom of edge */;
+	s32 direction /*! 1 or -1 (direction through the points) */;
+} polygon_chain_t;
+
 static int is_point_visible(const sg_bmap_t * bmap, sg_point_t p);
 static int truncate_visible(const sg_bmap_t * bmap, sg_point_t * p, sg_area_t * d);
 
-static int draw_pour_recursive(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, sg_color_t active_color);
-static u16 calc_largest_delta(sg_point_t p0, sg_point_t p1);
+//state shared by the sg_draw_pour_spans() helpers
+typedef struct {
+	const sg_bmap_t * bmap;
+	sg_color_t active_color;
+	sg_bmap_data_t active_pattern;
+	sg_int_t x_min;
+	sg_int_t x_max /*! Last column inside the bounds */;
+	sg_int_t y_min;
+	sg_int_t y_max /*! Last row inside the bounds */;
+	sg_pour_span_t * spans;
+	u32 max_spans;
+	u32 count;
+	int dropped;
+	u32 * visited /*! One bit for each pixel in the bounds that was filled (zero if dropped spans are only counted) */;
+	u32 visited_columns /*! Words in each row of visited */;
+	sg_int_t drop_y_min /*! First row with a span that was dropped since the last rescan */;
+	sg_int_t drop_y_max /*! Last row with a span that was dropped since the last rescan */;
+} pour_stack_t;
+
+static int start_pour(pour_stack_t * pour, const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, u32 * visited, u32 visited_words);
+static void finish_pour(pour_stack_t * pour);
+static void draw_pour_stack(pour_stack_t * pour);
+static sg_int_t draw_pour_span(pour_stack_t * pour, sg_int_t x, sg_int_t y, int is_extend_left, sg_int_t * left);
+static void fill_pour_run(const pour_stack_t * pour, sg_int_t y, sg_int_t left, sg_int_t right);
+static void push_pour_span(pour_stack_t * pour, sg_int_t y, sg_int_t left, sg_int_t right, s8 dy);
+static void mark_pour_visited(const pour_stack_t * pour, sg_int_t y, sg_int_t left, sg_int_t right);
+static int find_pour_visited(const pour_stack_t * pour, sg_int_t y, sg_int_t x, sg_int_t * left, sg_int_t * right);
+static void rescan_pour(pour_stack_t * pour);
+static u32 draw_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, u32 drawn, int is_more, u32 dash_phase);
+static void draw_solid_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, u32 drawn, int is_more);
+static u32 calc_polyline_history(const sg_polyline_t * polyline);
+static void draw_thin_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, int is_continued);
+static void draw_thin_segment(const sg_bmap_t * bmap, line_cursor_t * line_cursor, sg_point_t p1, sg_point_t p2, u32 first_step, u32 last_step);
+static void move_line_cursor(const sg_bmap_t * bmap, line_cursor_t * line_cursor, sg_point_t p);
+static u32 calc_line_steps(sg_point_t p1, sg_point_t p2);
+static sg_point_t calc_line_point(sg_point_t p1, sg_point_t p2, u32 step);
+static int is_line_antialiased(const sg_bmap_t * bmap);
+static void draw_antialiased_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, int is_continued);
+static void draw_antialiased_segment(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2, u32 first_step, u32 last_step);
+static int is_line_dashed(const sg_bmap_t * bmap);
+static u32 calc_dash_run(u32 dash, u32 phase);
+static u32 draw_dashed_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, int is_continued, u32 dash_phase);
+static void draw_dash(const sg_bmap_t * bmap, line_cursor_t * line_cursor, sg_point_t p1, sg_point_t p2, u32 first_step, u32 last_step);
+static void draw_line_rectangle(const sg_bmap_t * bmap, const sg_region_t * region, int is_vertical, int is_reversed);
+static void draw_dashed_row(const sg_bmap_t * bmap, const sg_region_t * region, int is_reversed);
+static u32 reverse_dash(u32 dash);
+static void blend_pixel(const sg_bmap_t * bmap, s32 x, s32 y, u32 weight);
+static void draw_thick_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, sg_size_t thickness, u32 drawn, int is_more);
+static void init_thick_segment(thick_segment_t * segment, sg_point_t p1, sg_point_t p2, sg_size_t thickness);
+static void init_chain_segment(const thick_chain_t * chain, u32 point, thick_segment_t * segment);
+static int is_chain_disc(const thick_chain_t * chain, u32 point);
+static void add_thick_box(thick_boxes_t * boxes, const sg_region_t * bounds);
+static void grow_region(sg_region_t * region, const sg_region_t * bounds);
+static int is_region_overlap(const sg_region_t * a, const sg_region_t * b);
+static void init_thick_covered(const thick_chain_t * chain, thick_covered_t * covered, const thick_boxes_t * boxes, u32 limit, const sg_region_t * bounds);
+static void add_thick_covered(const thick_chain_t * chain, thick_covered_t * covered, u32 element, const sg_region_t * bounds);
+static int is_chain_element_near(const thick_chain_t * chain, u32 element, const sg_region_t * bounds);
+static void draw_thick_row(const sg_bmap_t * bmap, const thick_chain_t * chain, const thick_covered_t * covered, sg_int_t y, sg_region_t * spans, sg_int_t count);
+static s32 skip_chain_covered(const sg_bmap_t * bmap, const thick_chain_t * chain, const thick_covered_t * covered, sg_int_t y, s32 x, s32 x_max);
+static s32 find_chain_covered(const sg_bmap_t * bmap, const thick_chain_t * chain, const thick_covered_t * covered, sg_int_t y, s32 x, s32 x_max);
+static int get_covered_element(const thick_covered_t * covered, u32 * i, u32 * element);
+static int calc_chain_span(const sg_bmap_t * bmap, const thick_chain_t * chain, u32 element, sg_int_t y, sg_region_t * span);
+static int calc_thick_segment_span(const sg_bmap_t * bmap, const thick_segment_t * segment, s32 y, sg_region_t * span);
+static int is_polyline_closed(const sg_point_t * points, u32 count);
+static int clip_line(s32 major_start, s32 major_step, s32 major_size, s32 minor_start, s32 minor_step, s32 minor_size, u32 major_delta, u32 minor_delta, u32 * first, u32 * last);
+static u32 calc_line_minor_offset(u32 major_offset, u32 major_delta, u32 minor_delta, u32 * error);
+static void clip_span(sg_region_t * span, s64 a, s64 b, s64 lo, s64 hi);
+static int calc_disc_span(const sg_bmap_t * bmap, sg_region_t * span, sg_point_t center, sg_int_t y, sg_size_t thickness);
+static void draw_row_spans(const sg_bmap_t * bmap, sg_int_t y, sg_region_t * spans, sg_int_t count);
+static sg_int_t merge_row_spans(sg_region_t * spans, sg_int_t count);
+static void draw_merged_spans(const sg_bmap_t * bmap, sg_bmap_data_t * row, const sg_region_t * spans, sg_int_t count);
+static sg_int_t clip_row_spans(const sg_bmap_t * bmap, sg_region_t * spans, sg_int_t count);
+static s64 floor_divide(s64 dividend, s64 divisor);
+static void ellipse_start(ellipse_t * ellipse, s32 rx, s32 ry);
+static s32 ellipse_half_width(ellipse_t * ellipse, s32 row);
+static void draw_arc_rows(const sg_bmap_t * bmap, sg_point_t center, s32 rx_outer, s32 ry_outer, s32 rx_inner, s32 ry_inner, const arc_sector_t * sector, sg_point_t * corners);
+static sg_int_t calc_arc_row_spans(const arc_sector_t * sector, sg_point_t center, s32 y, s32 outer, s32 inner, sg_region_t * spans);
+static int init_arc_sector(arc_sector_t * sector, s16 start, s16 end, s32 rx, s32 ry);
+static int init_round_rect(round_rect_t * shape, s32 left, s32 top, s32 right, s32 bottom, const s32 * radius);
+static void calc_round_rect_span(round_rect_t * shape, s32 y, s32 * left, s32 * right);
+static void draw_bezier(const sg_bmap_t * bmap, const sg_point_t * points, int is_cubic, sg_point_t * corners);
+static void init_edge_walker(edge_walker_t * edge, sg_point_t top, sg_point_t bottom, int is_reversed);
+static void advance_edge_walker(edge_walker_t * edge);
+static void add_polygon_chain_row(polygon_chain_t * chain, const sg_point_t * points, u32 count, u32 bottom, s32 * left, s32 * right);
+static void draw_arc_dashed(const sg_bmap_t * bmap, const sg_region_t * region, s16 start, s16 end, s16 rotation, sg_point_t * corners);
+static u32 calc_bezier_flatness(sg_point_t p0, sg_point_t p1, sg_point_t p2);
+static u32 calc_sqrt_ceiling(u64 value);
+static void init_bezier_axis(sg_bezier_axis_t * axis, s64 p0, s64 p1, s64 p2, s64 p3, int is_cubic, u32 segments);
+static sg_int_t step_bezier_axis(sg_bezier_axis_t * axis);
+static void draw_arc_rotated(const sg_bmap_t * bmap, const sg_region_t * region, s16 start, s16 end, s16 rotation, sg_point_t * corners);
+static void draw_rectangle_batch(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count);
+static void draw_rectangle_sweep(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count);
+static int is_rop_repeatable(u8 rop);
+static s32 draw_rectangle_band(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count, s32 y);
+static void draw_sub_bitmap(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg_bmap_t * bmap_src, const sg_region_t * region_src, int rop);
+
+//sg_draw_rectangles() merges this many rectangles at a time (if the pen can draw a pixel twice)
+#define DRAW_RECTANGLES_BATCH 32
+
+//spans of a row that sg_draw_rectangles() merges at a time (if the whole list is merged)
+#define DRAW_RECTANGLES_SPANS 32
+
+//spans that sg_draw_pour() can hold on the stack (7 bytes each)
+#define DRAW_POUR_SPANS 256
+
+//words of visited mask that sg_draw_pour() keeps on the stack (bounds up to 8192 pixels)
+#define DRAW_POUR_VISITED_WORDS 256
+
+//largest scale for sg_draw_downsample() and the destination pixels it reduces at a time
+#define DRAW_DOWNSAMPLE_MAX 4
+#define DRAW_DOWNSAMPLE_STRIP 64
+
+//draw_sub_bitmap() uses the pen rather than a ternary raster operation
+#define DRAW_ROP_PEN (-1)
 
 sg_color_t sg_get_pixel(const sg_bmap_t * bmap, sg_point_t p){
 	sg_cursor_t cursor;
@@ -34,19 +281,25 @@ void sg_draw_pixel(const sg_bmap_t * bmap, sg_point_t p){
 
 
 void sg_draw_line(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2){
-	int dx, dy;
-	int adx, ady;
-	int rise, run;
-	int i;
 	sg_region_t region;
-	sg_point_t tmp;
+	sg_point_t points[2];
 	sg_size_t thickness = bmap->pen.thickness;
-	sg_size_t half_thick;
+	int is_capped = (bmap->pen.o_flags & (SG_PEN_FLAG_IS_CAP_SQUARE|SG_PEN_FLAG_IS_CAP_ROUND)) != 0;
 
 	if( thickness == 0 ){
 		thickness = 1;
 	}
 
+	points[0] = p1;
+	points[1] = p2;
+
+	//horizontal and vertical lines are rectangles unless the ends are capped
+	if( (is_capped && (thickness > 1)) ||
+			((thickness == 1) && is_line_antialiased(bmap)) ){
+		draw_polyline(bmap, points, 2, 0, 0, bmap->pen.dash_phase);
+		return;
+	}
+
 	if( p2.y == p1.y ){
 		if( p1.x < p2.x ){
 			region.point.x = p1.x;
@@ -58,7 +311,7 @@ void sg_draw_line(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2){
 
 		region.area.height = bmap->pen.thickness;
 		region.point.y = p2.y - region.area.height / 2;
-		sg_draw_rectangle(bmap, &region);
+		draw_line_rectangle(bmap, &region, 0, p1.x > p2.x);
 		return;
 	}
 
@@ -74,82 +327,1849 @@ void sg_draw_line(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2){
 
 		region.area.width = bmap->pen.thickness;
 		region.point.x = p2.x - region.area.width / 2;
-		sg_draw_rectangle(bmap, &region);
+		draw_line_rectangle(bmap, &region, 1, p1.y > p2.y);
 		return;
 	}
 
-	half_thick = thickness/2;
+	draw_polyline(bmap, points, 2, 0, 0, bmap->pen.dash_phase);
+}
+
+/*
+ * Draws a horizontal or vertical line as a rectangle
+ *
+ * When the pen is dashed, a one pixel high line is drawn with
+ * draw_dashed_row(). Otherwise each dash is its own rectangle so the rows
+ * are still filled a word at a time. The pattern starts at the first
+ * point of the line which is the far end of region if is_reversed is set.
+ *
+ */
+void draw_line_rectangle(const sg_bmap_t * bmap, const sg_region_t * region, int is_vertical, int is_reversed){
+	const u32 dash = bmap->pen.dash;
+	const u32 length = is_vertical ? region->area.height : region->area.width;
+	sg_region_t dash_region;
+	u32 phase;
+	u32 first;
+	u32 offset;
+	u32 run;
+
+	if( is_line_dashed(bmap) == 0 ){
+		sg_draw_rectangle(bmap, region);
+		return;
+	}
+
+	if( (is_vertical == 0) && (region->area.height == 1) ){
+		draw_dashed_row(bmap, region, is_reversed);
+		return;
+	}
+
+	dash_region = *region;
+	phase = bmap->pen.dash_phase & 31;
+	for(first=0; first < length; first += run){
+		run = calc_dash_run(dash, phase);
+		if( run > length - first ){
+			run = length - first;
+		}
+
+		if( (dash >> phase) & 1 ){
+			offset = is_reversed ? length - first - run : first;
+			if( is_vertical ){
+				dash_region.point.y = region->point.y + offset;
+				dash_region.area.height = run;
+			} else {
+				dash_region.point.x = region->point.x + offset;
+				dash_region.area.width = run;
+			}
+			sg_draw_rectangle(bmap, &dash_region);
+		}
+		phase = (phase + run) & 31;
+	}
+}
+
+/*
+ * Draws a one pixel high dashed line with the dash bits as the word masks
+ *
+ * A reversed line walks the dash from its right end, which is the same as
+ * walking the bit reversed dash from its left end.
+ *
+ */
+void draw_dashed_row(const sg_bmap_t * bmap, const sg_region_t * region, int is_reversed){
+	sg_cursor_t cursor;
+	sg_point_t p = region->point;
+	sg_area_t d = region->area;
+	u32 dash = bmap->pen.dash;
+	u32 phase = bmap->pen.dash_phase;
+
+	if( is_reversed ){
+		dash = reverse_dash(dash);
+		phase = 0 - phase - region->area.width;
+	}
+
+	if( truncate_visible(bmap, &p, &d) == 0 ){
+		return;
+	}
+
+	sg_cursor_set(&cursor, bmap, p);
+	sg_cursor_draw_dash(&cursor, d.width, dash, (phase + p.x - region->point.x) & 31);
+}
+
+//reverses the order of the bits in dash
+u32 reverse_dash(u32 dash){
+	dash = ((dash >> 1) & 0x55555555) | ((dash & 0x55555555) << 1);
+	dash = ((dash >> 2) & 0x33333333) | ((dash & 0x33333333) << 2);
+	dash = ((dash >> 4) & 0x0f0f0f0f) | ((dash & 0x0f0f0f0f) << 4);
+	dash = ((dash >> 8) & 0x00ff00ff) | ((dash & 0x00ff00ff) << 8);
+	return (dash >> 16) | (dash << 16);
+}
+
+void sg_draw_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count){
+	draw_polyline(bmap, points, count, 0, 0, bmap->pen.dash_phase);
+}
+
+void sg_polyline_start(sg_polyline_t * polyline, const sg_bmap_t * bmap){
+	polyline->bmap = bmap;
+	polyline->count = 0;
+	polyline->drawn = 0;
+	polyline->dash_phase = bmap->pen.dash_phase & 31;
+}
+
+void sg_polyline_add(sg_polyline_t * polyline, sg_point_t p){
+	u32 keep;
+
+	if( polyline->count > 0 ){
+		if( polyline->points[polyline->count-1].point == p.point ){
+			return;
+		}
+
+		if( polyline->count == SG_POLYLINE_POINTS ){
+			//the next batch starts where this one ends and keeps the points it needs to check
+			polyline->dash_phase = draw_polyline(polyline->bmap, polyline->points, polyline->count, polyline->drawn, 1, polyline->dash_phase);
+			keep = calc_polyline_history(polyline);
+			memmove(polyline->points, polyline->points + polyline->count - keep, keep * sizeof(sg_point_t));
+			polyline->count = keep;
+			polyline->drawn = keep;
+		}
+	}
+	polyline->points[polyline->count++] = p;
+}
+
+void sg_polyline_finish(sg_polyline_t * polyline){
+	if( (polyline->count > polyline->drawn) || (polyline->drawn == 0) ){
+		polyline->dash_phase = draw_polyline(polyline->bmap, polyline->points, polyline->count, polyline->drawn, 0, polyline->dash_phase);
+	}
+	polyline->count = 0;
+}
+
+/*
+ * Number of points at the end of a full buffer to keep for the next batch
+ *
+ * A thick line's next batch skips the pixels of the kept points' segments
+ * and joints. Points are kept back to the first one that is farther than
+ * the thickness (plus a pixel) from the last point, so every element that
+ * reaches the pixels around the joint is checked. Parts of the chain
+ * further back are not, so a chain that crosses itself across a buffer
+ * flush can still draw the crossing twice.
+ *
+ */
+u32 calc_polyline_history(const sg_polyline_t * polyline){
+	const sg_point_t last = polyline->points[polyline->count - 1];
+	const s32 reach = polyline->bmap->pen.thickness + 1;
+	u32 keep = 1;
+	sg_point_t p;
+
+	if( polyline->bmap->pen.thickness <= 1 ){
+		return 1;
+	}
+
+	while( keep < SG_POLYLINE_POINTS/2 ){
+		p = polyline->points[polyline->count - 1 - keep];
+		keep++;
+		if( (abs_value(p.x - last.x) > reach) || (abs_value(p.y - last.y) > reach) ){
+			break;
+		}
+	}
+
+	return keep;
+}
+
+/*
+ * Draws a polyline
+ *
+ * If drawn is non-zero, the first drawn points (and the lines between
+ * them) were drawn by an earlier call and only the rest of the chain is
+ * drawn. The last of them is where the chain continues. If is_more is
+ * non-zero, the chain continues past the last point in a later call.
+ * The first pixel uses bit dash_phase of the pen's dash pattern. The
+ * bit for the pixel after the last one is returned.
+ *
+ */
+u32 draw_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, u32 drawn, int is_more, u32 dash_phase){
+	if( count == 0 ){
+		return dash_phase;
+	}
+
+	if( is_line_dashed(bmap) ){
+		//each dash is drawn on its own so only the point where the chain continues is needed
+		if( drawn > 1 ){
+			points += drawn - 1;
+			count -= drawn - 1;
+		}
+		return draw_dashed_polyline(bmap, points, count, drawn != 0, dash_phase);
+	}
+
+	draw_solid_polyline(bmap, points, count, drawn, is_more);
+	return dash_phase;
+}
+
+void draw_solid_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, u32 drawn, int is_more){
+	sg_size_t thickness = bmap->pen.thickness;
+
+	if( thickness > 1 ){
+		draw_thick_polyline(bmap, points, count, thickness, drawn, is_more);
+		return;
+	}
+
+	//single pixel lines only need to skip the pixel where the chain continues
+	if( drawn > 1 ){
+		points += drawn - 1;
+		count -= drawn - 1;
+	}
+
+	if( is_line_antialiased(bmap) ){
+		draw_antialiased_polyline(bmap, points, count, drawn != 0);
+	} else {
+		draw_thin_polyline(bmap, points, count, drawn != 0);
+	}
+}
+
+//a chain that ends where it starts is closed
+int is_polyline_closed(const sg_point_t * points, u32 count){
+	return (count > 2) && (points[0].point == points[count-1].point);
+}
+
+/*
+ * Draws a chain of single pixel wide lines
+ *
+ * Each segment is clipped to the bitmap once. Because the clipped range is
+ * computed from the Bresenham error term, the clipped line draws exactly
+ * the same pixels as the visible part of the whole line. The pixels are then
+ * drawn by stepping a cursor in place. The first pixel of each segment
+ * after the first one is skipped because it is the last pixel of the
+ * previous segment.
+ *
+ */
+void draw_thin_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, int is_continued){
+	line_cursor_t line_cursor;
+	//the last pixel of a closed chain is its first pixel
+	const int is_closed = (is_continued == 0) && is_polyline_closed(points, count);
+	u32 first_step = is_continued ? 1 : 0;
+	u32 i;
+
+	line_cursor.is_set = 0;
+	for(i=0; i+1 < count; i++){
+		if( points[i].point != points[i+1].point ){
+			draw_thin_segment(bmap, &line_cursor, points[i], points[i+1], first_step, calc_line_steps(points[i], points[i+1]) - (is_closed && (i+2 == count)));
+			first_step = 1;
+		}
+	}
+
+	//a chain that doesn't go anywhere is a single pixel
+	if( first_step == 0 ){
+		sg_draw_pixel(bmap, points[0]);
+	}
+}
+
+//draws the pixels of p1 to p2 that are first_step to last_step steps along the major axis
+void draw_thin_segment(const sg_bmap_t * bmap, line_cursor_t * line_cursor, sg_point_t p1, sg_point_t p2, u32 first_step, u32 last_step){
+	sg_cursor_line_t line;
+	sg_point_t start;
+	s32 dx = p2.x - p1.x;
+	s32 dy = p2.y - p1.y;
+	u32 adx = abs_value(dx);
+	u32 ady = abs_value(dy);
+	u32 major_delta;
+	u32 minor_delta;
+	u32 first;
+	u32 last;
+	u32 minor_offset;
+	int is_visible;
+
+	line.step_x = dx < 0 ? -1 : 1;
+	line.step_y = dy < 0 ? -1 : 1;
+
+	if( adx >= ady ){
+		line.is_y_major = 0;
+		major_delta = adx;
+		minor_delta = ady;
+		is_visible = clip_line(p1.x, line.step_x, bmap->area.width, p1.y, line.step_y, bmap->area.height, adx, ady, &first, &last);
+	} else {
+		line.is_y_major = 1;
+		major_delta = ady;
+		minor_delta = adx;
+		is_visible = clip_line(p1.y, line.step_y, bmap->area.height, p1.x, line.step_x, bmap->area.width, ady, adx, &first, &last);
+	}
+
+	if( is_visible == 0 ){
+		line_cursor->is_set = 0;
+		return;
+	}
+
+	if( first < first_step ){ first = first_step; }
+	if( last > last_step ){ last = last_step; }
+	if( first > last ){
+		line_cursor->is_set = 0;
+		return;
+	}
+
+	minor_offset = calc_line_minor_offset(first, major_delta, minor_delta, &line.error);
+	if( line.is_y_major ){
+		start.x = p1.x + line.step_x*(s32)minor_offset;
+		start.y = p1.y + line.step_y*(s32)first;
+	} else {
+		start.x = p1.x + line.step_x*(s32)first;
+		start.y = p1.y + line.step_y*(s32)minor_offset;
+	}
+	line.error_step = 2*minor_delta;
+	line.error_limit = 2*major_delta;
+	line.count = last - first + 1;
+
+	move_line_cursor(bmap, line_cursor, start);
+	sg_cursor_draw_line(&line_cursor->cursor, &line);
+
+	//the cursor is left on the last pixel which is p2 unless the end was clipped
+	line_cursor->position = p2;
+	line_cursor->is_set = (last == major_delta);
+}
+
+//number of steps along the major axis from p1 to p2
+u32 calc_line_steps(sg_point_t p1, sg_point_t p2){
+	const u32 adx = abs_value(p2.x - p1.x);
+	const u32 ady = abs_value(p2.y - p1.y);
+	return adx > ady ? adx : ady;
+}
+
+//pixel that a thin line from p1 to p2 draws after step steps along the major axis
+sg_point_t calc_line_point(sg_point_t p1, sg_point_t p2, u32 step){
+	const s32 dx = p2.x - p1.x;
+	const s32 dy = p2.y - p1.y;
+	const u32 adx = abs_value(dx);
+	const u32 ady = abs_value(dy);
+	sg_point_t result;
+	u32 error;
+
+	if( adx >= ady ){
+		result.x = p1.x + (dx < 0 ? -(s32)step : (s32)step);
+		result.y = p1.y + (dy < 0 ? -1 : 1) * (s32)calc_line_minor_offset(step, adx, ady, &error);
+	} else {
+		result.y = p1.y + (dy < 0 ? -(s32)step : (s32)step);
+		result.x = p1.x + (dx < 0 ? -1 : 1) * (s32)calc_line_minor_offset(step, ady, adx, &error);
+	}
+	return result;
+}
+
+//moves the cursor to p (relative to the end of the last segment when it is known)
+void move_line_cursor(const sg_bmap_t * bmap, line_cursor_t * line_cursor, sg_point_t p){
+	if( line_cursor->is_set ){
+		line_cursor->cursor.target += (s32)(p.y - line_cursor->position.y) * bmap->columns;
+		sg_cursor_advance(&line_cursor->cursor, p.x - line_cursor->position.x);
+	} else {
+		sg_cursor_set(&line_cursor->cursor, bmap, p);
+	}
+}
+
+//antialiasing blends pixel values so it needs 2 to 8 bits per pixel
+int is_line_antialiased(const sg_bmap_t * bmap){
+	return sg_pen_is_antialiased(bmap);
+}
+
+/*
+ * Draws a chain of antialiased single pixel wide lines
+ *
+ * This follows draw_thin_polyline() so each joint is blended only once.
+ *
+ */
+void draw_antialiased_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, int is_continued){
+	const int is_closed = (is_continued == 0) && is_polyline_closed(points, count);
+	u32 first_step = is_continued ? 1 : 0;
+	u32 i;
+
+	for(i=0; i+1 < count; i++){
+		if( points[i].point != points[i+1].point ){
+			draw_antialiased_segment(bmap, points[i], points[i+1], first_step, calc_line_steps(points[i], points[i+1]) - (is_closed && (i+2 == count)));
+			first_step = 1;
+		}
+	}
+
+	if( first_step == 0 ){
+		blend_pixel(bmap, points[0].x, points[0].y, 256);
+	}
+}
+
+/*
+ * Draws steps first_step to last_step of p1 to p2 using Xiaolin Wu's algorithm
+ *
+ * For each step along the major axis, the exact minor axis position is
+ * kept in 32.32 fixed point. The coverage is split between the two pixels
+ * that straddle that position using the fraction. Both pixels are blended
+ * in the same pass so nothing else in the bitmap is read.
+ *
+ */
+void draw_antialiased_segment(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2, u32 first_step, u32 last_step){
+	const s32 dx = p2.x - p1.x;
+	const s32 dy = p2.y - p1.y;
+	const u32 adx = abs_value(dx);
+	const u32 ady = abs_value(dy);
+	const int is_y_major = ady > adx;
+	const u32 major_delta = is_y_major ? ady : adx;
+	const u32 minor_delta = is_y_major ? adx : ady;
+	const s32 major_start = is_y_major ? p1.y : p1.x;
+	const s32 minor_start = is_y_major ? p1.x : p1.y;
+	const s32 major_step = (is_y_major ? dy : dx) < 0 ? -1 : 1;
+	const s32 minor_step = (is_y_major ? dx : dy) < 0 ? -1 : 1;
+	const s32 major_size = is_y_major ? bmap->area.height : bmap->area.width;
+	const u64 slope = ((u64)minor_delta << 32) / major_delta;
+	u64 position;
+	s32 low;
+	s32 high;
+	s32 i;
+
+	//major axis steps that are inside the bitmap
+	if( major_step > 0 ){
+		low = -major_start;
+		high = major_size - 1 - major_start;
+	} else {
+		low = major_start - (major_size - 1);
+		high = major_start;
+	}
+	if( low < (s32)first_step ){ low = first_step; }
+	if( high > (s32)last_step ){ high = last_step; }
+
+	position = slope * (u32)low;
+	for(i=low; i <= high; i++){
+		const s32 major = major_start + major_step*i;
+		const s32 minor = minor_start + minor_step*(s32)(position >> 32);
+		//coverage of the second pixel out of 256
+		const u32 weight = (u32)position >> 24;
+
+		if( is_y_major ){
+			blend_pixel(bmap, minor, major, 256 - weight);
+			if( weight ){ blend_pixel(bmap, minor + minor_step, major, weight); }
+		} else {
+			blend_pixel(bmap, major, minor, 256 - weight);
+			if( weight ){ blend_pixel(bmap, major, minor + minor_step, weight); }
+		}
+		position += slope;
+	}
+}
+
+//moves the pixel at (x, y) weight/256 of the way to the pen color
+void blend_pixel(const sg_bmap_t * bmap, s32 x, s32 y, u32 weight){
+	sg_cursor_t cursor;
+	sg_color_t dest;
+	sg_color_t color;
+	sg_bmap_data_t mask;
+
+	if( (x < 0) || (y < 0) || (x >= bmap->area.width) || (y >= bmap->area.height) ){
+		return;
+	}
+
+	sg_cursor_set(&cursor, bmap, sg_point(x,y));
+	mask = SG_PIXEL_MASK(bmap);
+	dest = sg_cursor_get_pixel_no_increment(&cursor);
+	color = (dest*(256 - weight) + (bmap->pen.color & mask)*weight + 128) >> 8;
+	*cursor.target = (*cursor.target & ~(mask << cursor.shift)) | (color << cursor.shift);
+}
+
+void sg_draw_coverage_row(const sg_bmap_t * bmap, sg_int_t x, sg_int_t y, const u16 * coverage, sg_size_t width){
+	const u32 bits_per_pixel = SG_BITS_PER_PIXEL_VALUE(bmap);
+	const sg_color_t mask = SG_PIXEL_MASK(bmap);
+	const sg_color_t color = bmap->pen.color & mask;
+	sg_bmap_data_t * row = bmap->data + y*bmap->columns;
+	sg_bmap_data_t * word;
+	sg_color_t dest;
+	u32 weight;
+	u32 bit;
+	u32 shift;
+	sg_size_t i;
+
+	for(i=0; i < width; i++){
+		weight = coverage[i];
+		if( weight == 0 ){
+			continue;
+		}
+		bit = (x + i) * bits_per_pixel;
+		word = row + bit / SG_BITS_PER_WORD;
+		shift = bit % SG_BITS_PER_WORD;
+		dest = (*word >> shift) & mask;
+		dest = (dest*(256 - weight) + color*weight + 128) >> 8;
+		*word = (*word & ~(mask << shift)) | (dest << shift);
+	}
+}
+
+//a dash pattern with every bit set is a solid line
+int is_line_dashed(const sg_bmap_t * bmap){
+	return (bmap->pen.o_flags & SG_PEN_FLAG_IS_DASH) && (bmap->pen.dash != 0xffffffff);
+}
+
+//number of pixels starting at bit phase of dash that match that bit (up to 32)
+u32 calc_dash_run(u32 dash, u32 phase){
+	u32 bits = phase ? (dash >> phase) | (dash << (32 - phase)) : dash;
+	if( bits & 1 ){
+		bits = ~bits;
+	}
+	return bits ? __builtin_ctz(bits) : 32;
+}
+
+/*
+ * Draws a chain of lines with the pen's dash pattern
+ *
+ * Each pixel along the major axis of a segment uses the next bit of the
+ * pattern (the joints are counted once). The runs of set bits are drawn
+ * as pieces of the segment using the same rasterizer as solid lines.
+ *
+ */
+u32 draw_dashed_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, int is_continued, u32 dash_phase){
+	const u32 dash = bmap->pen.dash;
+	const int is_closed = (is_continued == 0) && is_polyline_closed(points, count);
+	line_cursor_t line_cursor;
+	u32 first_step = is_continued ? 1 : 0;
+	u32 last_step;
+	u32 step;
+	u32 run;
+	u32 i;
+
+	dash_phase &= 31;
+	line_cursor.is_set = 0;
+	for(i=0; i+1 < count; i++){
+		if( points[i].point == points[i+1].point ){
+			continue;
+		}
+
+		last_step = calc_line_steps(points[i], points[i+1]);
+		if( is_closed && (i+2 == count) ){
+			//the last pixel is the first pixel of the chain
+			last_step--;
+		}
+
+		for(step = first_step; step <= last_step; step += run){
+			run = calc_dash_run(dash, dash_phase);
+			if( run > last_step - step + 1 ){
+				run = last_step - step + 1;
+			}
+			if( (dash >> dash_phase) & 1 ){
+				draw_dash(bmap, &line_cursor, points[i], points[i+1], step, step + run - 1);
+			} else {
+				line_cursor.is_set = 0;
+			}
+			dash_phase = (dash_phase + run) & 31;
+		}
+		first_step = 1;
+	}
+
+	if( first_step == 0 ){
+		//a chain that doesn't go anywhere is a single dot
+		if( (dash >> dash_phase) & 1 ){
+			draw_solid_polyline(bmap, points, 1, 0, 0);
+		}
+		dash_phase = (dash_phase + 1) & 31;
+	}
+
+	return dash_phase;
+}
+
+//draws steps first_step to last_step of p1 to p2
+void draw_dash(const sg_bmap_t * bmap, line_cursor_t * line_cursor, sg_point_t p1, sg_point_t p2, u32 first_step, u32 last_step){
+	const sg_size_t thickness = bmap->pen.thickness;
+	sg_point_t points[2];
+	u32 steps;
+
+	if( thickness > 1 ){
+		//a dash of n pixels is n pixels long so it ends at the start of the next pixel
+		steps = calc_line_steps(p1, p2);
+		if( last_step < steps ){
+			last_step++;
+		} else if( first_step == last_step ){
+			first_step--;
+		}
+		points[0] = calc_line_point(p1, p2, first_step);
+		points[1] = calc_line_point(p1, p2, last_step);
+		draw_thick_polyline(bmap, points, 2, thickness, 0, 0);
+		line_cursor->is_set = 0;
+	} else if( is_line_antialiased(bmap) ){
+		draw_antialiased_segment(bmap, p1, p2, first_step, last_step);
+	} else {
+		draw_thin_segment(bmap, line_cursor, p1, p2, first_step, last_step);
+	}
+}
+
+/*
+ * Calculates the range of major axis steps (first to last) where the line is
+ * inside the bitmap. Returns zero if no part of the line is visible.
+ *
+ * After i major axis steps, the line has taken
+ * (2*i*minor_delta + major_delta) / (2*major_delta) minor axis steps.
+ * That is inverted to find the steps where the minor axis enters
+ * and leaves the bitmap.
+ *
+ */
+int clip_line(s32 major_start, s32 major_step, s32 major_size, s32 minor_start, s32 minor_step, s32 minor_size, u32 major_delta, u32 minor_delta, u32 * first, u32 * last){
+	s32 low;
+	s32 high;
+	s32 minor_low;
+	s32 minor_high;
+	s32 i;
+
+	//major axis offsets that are inside the bitmap
+	if( major_step > 0 ){
+		low = -major_start;
+		high = major_size - 1 - major_start;
+	} else {
+		low = major_start - (major_size - 1);
+		high = major_start;
+	}
+	if( low < 0 ){ low = 0; }
+	if( high > (s32)major_delta ){ high = major_delta; }
+
+	//minor axis offsets that are inside the bitmap
+	if( minor_step > 0 ){
+		minor_low = -minor_start;
+		minor_high = minor_size - 1 - minor_start;
+	} else {
+		minor_low = minor_start - (minor_size - 1);
+		minor_high = minor_start;
+	}
+	if( minor_low < 0 ){ minor_low = 0; }
+	if( minor_high > (s32)minor_delta ){ minor_high = minor_delta; }
+	if( minor_low > minor_high ){
+		return 0;
+	}
+
+	//first major step with at least minor_low minor steps
+	if( minor_low > 0 ){
+		i = ((u64)major_delta*(2*minor_low - 1) + 2*minor_delta - 1) / (2*minor_delta);
+		if( i > low ){ low = i; }
+	}
+
+	//last major step with at most minor_high minor steps
+	if( minor_high < (s32)minor_delta ){
+		i = ((u64)major_delta*(2*minor_high + 1) + 2*minor_delta - 1) / (2*minor_delta) - 1;
+		if( i < high ){ high = i; }
+	}
+
+	if( low > high ){
+		return 0;
+	}
+
+	*first = low;
+	*last = high;
+	return 1;
+}
+
+//minor axis steps and error term (see sg_cursor_line_t) after major_offset major axis steps
+u32 calc_line_minor_offset(u32 major_offset, u32 major_delta, u32 minor_delta, u32 * error){
+	u64 numerator = 2*(u64)major_offset*minor_delta + major_delta;
+	*error = numerator % (2*major_delta);
+	return numerator / (2*major_delta);
+}
+
+/*
+ * Draws a chain of lines that are more than one pixel wide
+ *
+ * Each segment is treated as a quad (extended for square caps) and a pixel
+ * is drawn if its center is inside the quad. The joints are discs and
+ * round caps add a disc at each end. Each row of the bitmap that the chain
+ * crosses is solved for the spans of pixels that are inside and the spans
+ * are merged and filled using the cursor's word fill. So the line has the
+ * same width at any angle, no pixel is drawn twice, and the cost depends
+ * on the number of words covered rather than pixels.
+ *
+ * Long chains are drawn DRAW_THICK_SEGMENTS segments at a time. The
+ * pixels of a row that an earlier batch (or an earlier call, see drawn)
+ * already covered are skipped (see draw_thick_row()) so pixels where
+ * batches meet aren't drawn again. Only the earlier elements that reach
+ * the batch's bounding box are checked, so on a chain that doesn't
+ * double back that is a handful of elements per batch. They are found
+ * through the bounding boxes of the earlier batches (see thick_boxes_t)
+ * rather than by checking every earlier element, so the cost of a batch
+ * doesn't grow with the length of the chain.
+ *
+ */
+void draw_thick_polyline(const sg_bmap_t * bmap, const sg_point_t * points, u32 count, sg_size_t thickness, u32 drawn, int is_more){
+	thick_chain_t chain;
+	thick_boxes_t boxes;
+	thick_covered_t covered;
+	thick_segment_t segments[DRAW_THICK_SEGMENTS];
+	sg_region_t spans[2*DRAW_THICK_SEGMENTS + 1];
+	sg_region_t bounds;
+	u32 first;
+	u32 segment_count;
+	u32 disc_mask;
+	u32 point;
+	u32 limit;
+	u32 i;
+	s32 x_min;
+	s32 x_max;
+	s32 y_min;
+	s32 y_max;
+	s32 y;
+	sg_int_t span_count;
+
+	chain.points = points;
+	chain.count = count;
+	chain.thickness = thickness;
+	chain.o_flags = bmap->pen.o_flags;
+	chain.drawn = drawn;
+	chain.is_more = is_more != 0;
+	chain.is_closed = (drawn == 0) && (is_more == 0) && is_polyline_closed(points, count);
+
+	first = drawn ? drawn - 1 : 0;
+	boxes.start = first;
+	boxes.batches = 1;
+	boxes.count = 0;
+	do {
+		segment_count = count - 1 - first;
+		if( segment_count > DRAW_THICK_SEGMENTS ){
+			segment_count = DRAW_THICK_SEGMENTS;
+		}
+
+		x_min = points[first].x;
+		x_max = points[first].x;
+		y_min = points[first].y;
+		y_max = points[first].y;
+		disc_mask = 0;
+		for(i=0; i <= segment_count; i++){
+			point = first + i;
+			if( points[point].x < x_min ){ x_min = points[point].x; }
+			if( points[point].x > x_max ){ x_max = points[point].x; }
+			if( points[point].y < y_min ){ y_min = points[point].y; }
+			if( points[point].y > y_max ){ y_max = points[point].y; }
+
+			//the last joint of a batch is drawn with the next batch (an earlier call drew the ones before drawn)
+			if( is_chain_disc(&chain, point) && (point >= drawn) && ((i < segment_count) || (point == count - 1)) ){
+				disc_mask |= (1<<i);
+			}
+
+			if( i < segment_count ){
+				init_chain_segment(&chain, point, segments + i);
+			}
+		}
+
+		x_min -= thickness;
+		x_max += thickness;
+		y_min -= thickness;
+		y_max += thickness;
+
+		//discs and segments before first plus the joint at first if an earlier call drew it
+		limit = 2*first;
+		if( drawn && (limit < 2*drawn - 1) ){
+			limit = 2*drawn - 1;
+		}
+		bounds.point = sg_point(x_min, y_min);
+		bounds.area = sg_dim(x_max - x_min + 1, y_max - y_min + 1);
+		init_thick_covered(&chain, &covered, &boxes, limit, &bounds);
+
+		if( y_min < 0 ){ y_min = 0; }
+		if( y_max >= bmap->area.height ){ y_max = bmap->area.height - 1; }
+
+		for(y = y_min; y <= y_max; y++){
+			span_count = 0;
+			for(i=0; i < segment_count; i++){
+				if( calc_thick_segment_span(bmap, segments + i, y, spans + span_count) ){
+					span_count++;
+				}
+			}
+
+			for(i=0; i <= segment_count; i++){
+				if( (disc_mask & (1<<i)) && calc_disc_span(bmap, spans + span_count, points[first + i], y, thickness) ){
+					span_count++;
+				}
+			}
+
+			draw_thick_row(bmap, &chain, &covered, y, spans, span_count);
+		}
+
+		add_thick_box(&boxes, &bounds);
+		first += segment_count;
+	} while( first + 1 < count );
+}
+
+//sets up the segment from point to point + 1 including square caps at the ends of the chain
+void init_chain_segment(const thick_chain_t * chain, u32 point, thick_segment_t * segment){
+	init_thick_segment(segment, chain->points[point], chain->points[point+1], chain->thickness);
+	if( (chain->o_flags & SG_PEN_FLAG_IS_CAP_SQUARE) && (chain->is_closed == 0) ){
+		if( (point == 0) && (chain->drawn == 0) ){
+			segment->extend_start = segment->limit;
+		}
+		if( (point + 2 == chain->count) && (chain->is_more == 0) ){
+			segment->extend_end = segment->limit;
+		}
+	}
+}
+
+//checks if the chain has a disc at point (a joint or a round cap)
+int is_chain_disc(const thick_chain_t * chain, u32 point){
+	if( point < chain->drawn ){
+		//points an earlier call drew are joints of the whole chain
+		return 1;
+	}
+	if( (point == chain->count - 1) && chain->is_more ){
+		return 1;
+	}
+	if( (point == 0) || (point == chain->count - 1) ){
+		if( chain->is_closed ){
+			//the closing joint is drawn once
+			return point == 0;
+		}
+		return (chain->o_flags & SG_PEN_FLAG_IS_CAP_ROUND) != 0;
+	}
+	return 1;
+}
+
+//adds the bounds of the batch that was just drawn (pairs of boxes are merged when they run out)
+void add_thick_box(thick_boxes_t * boxes, const sg_region_t * bounds){
+	u32 index = boxes->count / boxes->batches;
+	u32 i;
+
+	if( index == DRAW_THICK_BOXES ){
+		for(i=0; i < DRAW_THICK_BOXES/2; i++){
+			boxes->bounds[i] = boxes->bounds[2*i];
+			grow_region(boxes->bounds + i, boxes->bounds + 2*i + 1);
+		}
+		boxes->batches *= 2;
+		index = boxes->count / boxes->batches;
+	}
+
+	if( boxes->count % boxes->batches == 0 ){
+		boxes->bounds[index] = *bounds;
+	} else {
+		grow_region(boxes->bounds + index, bounds);
+	}
+	boxes->count++;
+}
+
+//grows region so it also covers bounds
+void grow_region(sg_region_t * region, const sg_region_t * bounds){
+	s32 x_max = region->point.x + region->area.width;
+	s32 y_max = region->point.y + region->area.height;
+
+	if( bounds->point.x + bounds->area.width > x_max ){ x_max = bounds->point.x + bounds->area.width; }
+	if( bounds->point.y + bounds->area.height > y_max ){ y_max = bounds->point.y + bounds->area.height; }
+	if( bounds->point.x < region->point.x ){ region->point.x = bounds->point.x; }
+	if( bounds->point.y < region->point.y ){ region->point.y = bounds->point.y; }
+	region->area.width = x_max - region->point.x;
+	region->area.height = y_max - region->point.y;
+}
+
+int is_region_overlap(const sg_region_t * a, const sg_region_t * b){
+	return (a->point.x < b->point.x + b->area.width) &&
+			(b->point.x < a->point.x + a->area.width) &&
+			(a->point.y < b->point.y + b->area.height) &&
+			(b->point.y < a->point.y + a->area.height);
+}
+
+//lists the elements before limit that reach bounds (the earlier call's and those in boxes that overlap bounds)
+void init_thick_covered(const thick_chain_t * chain, thick_covered_t * covered, const thick_boxes_t * boxes, u32 limit, const sg_region_t * bounds){
+	const u32 box_points = boxes->batches * DRAW_THICK_SEGMENTS;
+	u32 element;
+	u32 end;
+	u32 box;
+
+	covered->boxes = boxes;
+	covered->limit = limit;
+	covered->history = chain->drawn ? 2*chain->drawn - 1 : 0;
+	covered->box_mask = 0;
+	covered->count = 0;
+
+	for(element = 0; element < covered->history; element++){
+		add_thick_covered(chain, covered, element, bounds);
+	}
+
+	for(box = 0; box * boxes->batches < boxes->count; box++){
+		if( is_region_overlap(boxes->bounds + box, bounds) ){
+			covered->box_mask |= (1<<box);
+			element = 2*(boxes->start + box*box_points);
+			end = element + 2*box_points;
+			if( element < covered->history ){ element = covered->history; }
+			if( end > limit ){ end = limit; }
+			for(; element < end; element++){
+				add_thick_covered(chain, covered, element, bounds);
+			}
+		}
+	}
+}
+
+//adds element to the list if it reaches bounds
+void add_thick_covered(const thick_chain_t * chain, thick_covered_t * covered, u32 element, const sg_region_t * bounds){
+	if( (covered->count <= DRAW_THICK_COVERED) && is_chain_element_near(chain, element, bounds) ){
+		if( covered->count < DRAW_THICK_COVERED ){
+			covered->element[covered->count] = element;
+		}
+		covered->count++;
+	}
+}
+
+//checks if the disc (even element) or segment (odd element) at point element/2 can reach bounds
+int is_chain_element_near(const thick_chain_t * chain, u32 element, const sg_region_t * bounds){
+	const u32 point = element / 2;
+	const sg_point_t * points = chain->points;
+	s32 x_min = points[point].x;
+	s32 x_max = points[point].x;
+	s32 y_min = points[point].y;
+	s32 y_max = points[point].y;
+
+	if( element & 0x01 ){
+		if( points[point+1].x < x_min ){ x_min = points[point+1].x; }
+		if( points[point+1].x > x_max ){ x_max = points[point+1].x; }
+		if( points[point+1].y < y_min ){ y_min = points[point+1].y; }
+		if( points[point+1].y > y_max ){ y_max = points[point+1].y; }
+	}
+
+	return (x_max + chain->thickness >= bounds->point.x) &&
+			(x_min - chain->thickness < bounds->point.x + bounds->area.width) &&
+			(y_max + chain->thickness >= bounds->point.y) &&
+			(y_min - chain->thickness < bounds->point.y + bounds->area.height);
+}
+
+/*
+ * Gets the covered element at or after position i
+ *
+ * i is the position in the list or, if the list overflowed, an element
+ * number that is moved past the boxes that don't overlap the batch.
+ * Returns zero when there are no more.
+ *
+ */
+int get_covered_element(const thick_covered_t * covered, u32 * i, u32 * element){
+	const thick_boxes_t * boxes = covered->boxes;
+	const u32 box_points = boxes->batches * DRAW_THICK_SEGMENTS;
+	u32 box;
+
+	if( covered->count <= DRAW_THICK_COVERED ){
+		if( *i < covered->count ){
+			*element = covered->element[*i];
+			return 1;
+		}
+		return 0;
+	}
+
+	while( *i < covered->limit ){
+		if( *i < covered->history ){
+			*element = *i;
+			return 1;
+		}
+		box = (*i/2 - boxes->start) / box_points;
+		if( covered->box_mask & (1<<box) ){
+			*element = *i;
+			return 1;
+		}
+		*i = 2*(boxes->start + (box + 1)*box_points);
+	}
+	return 0;
+}
+
+/*
+ * Draws the spans of a batch on row y
+ *
+ * If nothing was drawn near the batch before, the spans are merged and
+ * drawn. Otherwise the covered elements are solved again for row y and
+ * only the parts of the merged spans they don't cover are drawn. Only
+ * the parts that are near the row are solved so on most rows this is a
+ * few compares per covered element.
+ *
+ */
+void draw_thick_row(const sg_bmap_t * bmap, const thick_chain_t * chain, const thick_covered_t * covered, sg_int_t y, sg_region_t * spans, sg_int_t count){
+	sg_bmap_data_t * row = bmap->data + y*bmap->columns;
+	sg_region_t piece;
+	sg_int_t i;
+	s32 x;
+	s32 x_max;
+	s32 next;
+
+	count = merge_row_spans(spans, count);
+	if( covered->count == 0 ){
+		draw_merged_spans(bmap, row, spans, count);
+		return;
+	}
+
+	for(i=0; i < count; i++){
+		x = spans[i].point.x;
+		x_max = x + spans[i].area.width - 1;
+		for(;;){
+			x = skip_chain_covered(bmap, chain, covered, y, x, x_max);
+			if( x > x_max ){
+				break;
+			}
+			next = find_chain_covered(bmap, chain, covered, y, x, x_max);
+			piece.point.x = x;
+			piece.area.width = next - x;
+			draw_merged_spans(bmap, row, &piece, 1);
+			x = next;
+		}
+	}
+}
+
+//first pixel from x to x_max that isn't covered (x_max + 1 if there is none)
+s32 skip_chain_covered(const sg_bmap_t * bmap, const thick_chain_t * chain, const thick_covered_t * covered, sg_int_t y, s32 x, s32 x_max){
+	sg_region_t span;
+	u32 element;
+	u32 i;
+	int is_moved;
+
+	do {
+		is_moved = 0;
+		for(i = 0; (x <= x_max) && get_covered_element(covered, &i, &element); i++){
+			if( calc_chain_span(bmap, chain, element, y, &span) &&
+					(span.point.x <= x) && (x < span.point.x + span.area.width) ){
+				x = span.point.x + span.area.width;
+				is_moved = 1;
+			}
+		}
+	} while( is_moved && (x <= x_max) );
+
+	return x;
+}
+
+//first pixel after x (up to x_max + 1) that is covered
+s32 find_chain_covered(const sg_bmap_t * bmap, const thick_chain_t * chain, const thick_covered_t * covered, sg_int_t y, s32 x, s32 x_max){
+	sg_region_t span;
+	s32 next = x_max + 1;
+	u32 element;
+	u32 i;
+
+	for(i = 0; get_covered_element(covered, &i, &element); i++){
+		if( calc_chain_span(bmap, chain, element, y, &span) &&
+				(span.point.x > x) && (span.point.x < next) ){
+			next = span.point.x;
+		}
+	}
+
+	return next;
+}
+
+//span of row y for the disc (even element) or segment (odd element) at point element/2
+int calc_chain_span(const sg_bmap_t * bmap, const thick_chain_t * chain, u32 element, sg_int_t y, sg_region_t * span){
+	const u32 point = element / 2;
+	const sg_point_t * points = chain->points;
+	thick_segment_t segment;
+
+	if( (element & 0x01) == 0 ){
+		return is_chain_disc(chain, point) && calc_disc_span(bmap, span, points[point], y, chain->thickness);
+	}
+
+	//skip segments that don't reach the row before solving for the limit
+	if( (y < (points[point].y < points[point+1].y ? points[point].y : points[point+1].y) - chain->thickness) ||
+			(y > (points[point].y > points[point+1].y ? points[point].y : points[point+1].y) + chain->thickness) ){
+		return 0;
+	}
+
+	init_chain_segment(chain, point, &segment);
+	return calc_thick_segment_span(bmap, &segment, y, span);
+}
+
+void init_thick_segment(thick_segment_t * segment, sg_point_t p1, sg_point_t p2, sg_size_t thickness){
+	segment->start = p1;
+	segment->dx = p2.x - p1.x;
+	segment->dy = p2.y - p1.y;
+	segment->length_squared = segment->dx*segment->dx + segment->dy*segment->dy;
+	segment->limit = sg_calc_sqrt((u64)thickness*thickness*segment->length_squared);
+	segment->extend_start = 0;
+	segment->extend_end = 0;
+	segment->y_min = (p1.y < p2.y ? p1.y : p2.y) - thickness;
+	segment->y_max = (p1.y > p2.y ? p1.y : p2.y) + thickness;
+}
+
+//span of row y that is inside the segment's quad (returns zero if there is none)
+int calc_thick_segment_span(const sg_bmap_t * bmap, const thick_segment_t * segment, s32 y, sg_region_t * span){
+	const s64 dx = segment->dx;
+	const s64 dy = segment->dy;
+	const sg_point_t p1 = segment->start;
+
+	if( (y < segment->y_min) || (y > segment->y_max) ){
+		return 0;
+	}
+
+	//start with the whole row then narrow it to the quad
+	span->point.x = 0;
+	span->area.width = bmap->area.width;
+
+	//distance from the center line: -limit < 2*cross(p2 - p1, p - p1) <= limit
+	clip_span(
+				span,
+				-2*dy,
+				2*dx*(y - p1.y) + 2*dy*p1.x,
+				-segment->limit + 1,
+				segment->limit
+				);
+
+	//between the ends: -extend <= 2*dot(p2 - p1, p - p1) <= 2*|p2 - p1|^2 + extend
+	clip_span(
+				span,
+				2*dx,
+				2*dy*(y - p1.y) - 2*dx*p1.x,
+				-segment->extend_start,
+				2*segment->length_squared + segment->extend_end
+				);
+
+	return span->area.width != 0;
+}
+
+//narrows span to the x values where lo <= a*x + b <= hi
+void clip_span(sg_region_t * span, s64 a, s64 b, s64 lo, s64 hi){
+	s64 x_min = span->point.x;
+	s64 x_max = span->point.x + span->area.width - 1;
+	s64 value;
+
+	if( a == 0 ){
+		if( (b < lo) || (b > hi) ){
+			span->area.width = 0;
+		}
+		return;
+	}
+
+	if( a < 0 ){
+		//-a*x - b is between -hi and -lo
+		a = -a;
+		b = -b;
+		value = -hi;
+		hi = -lo;
+		lo = value;
+	}
+
+	value = floor_divide(lo - b + a - 1, a);
+	if( value > x_min ){ x_min = value; }
+	value = floor_divide(hi - b, a);
+	if( value < x_max ){ x_max = value; }
+
+	if( x_max < x_min ){
+		span->area.width = 0;
+	} else {
+		span->point.x = x_min;
+		span->area.width = x_max - x_min + 1;
+	}
+}
+
+//span of row y that is covered by a disc of diameter thickness at center (returns zero if there is none)
+int calc_disc_span(const sg_bmap_t * bmap, sg_region_t * span, sg_point_t center, sg_int_t y, sg_size_t thickness){
+	const s32 row = y - center.y;
+	s64 remaining;
+	s32 half_width;
+	s32 x_min;
+	s32 x_max;
+
+	//rows past the edge are rejected before squaring (the square of a far row overflows)
+	if( (row > (s32)thickness/2) || (row < -((s32)thickness/2)) ){
+		return 0;
+	}
+
+	remaining = (s64)thickness*thickness - 4*(s64)row*row;
+	if( remaining < 0 ){
+		return 0;
+	}
+
+	half_width = sg_calc_sqrt(remaining / 4);
+	x_min = center.x - half_width;
+	x_max = center.x + half_width;
+	if( x_min < 0 ){ x_min = 0; }
+	if( x_max >= bmap->area.width ){ x_max = bmap->area.width - 1; }
+	if( x_max < x_min ){
+		return 0;
+	}
+
+	span->point.x = x_min;
+	span->area.width = x_max - x_min + 1;
+	return 1;
+}
+
+//draws the spans on row y (overlapping spans are merged so no pixel is drawn twice)
+void draw_row_spans(const sg_bmap_t * bmap, sg_int_t y, sg_region_t * spans, sg_int_t count){
+	draw_merged_spans(bmap, bmap->data + y*bmap->columns, spans, merge_row_spans(spans, count));
+}
+
+void sg_draw_row_spans(const sg_bmap_t * bmap, sg_int_t y, sg_region_t * spans, sg_int_t count){
+	if( (y < 0) || (y >= bmap->area.height) ){
+		return;
+	}
+	draw_row_spans(bmap, y, spans, clip_row_spans(bmap, spans, count));
+}
+
+//sorts the spans and combines the ones that overlap or touch (returns the new count)
+sg_int_t merge_row_spans(sg_region_t * spans, sg_int_t count){
+	sg_region_t tmp;
+	sg_int_t merged;
+	sg_int_t i;
+	sg_int_t j;
+	s32 end;
+
+	//sort by starting point (there are only a few spans)
+	for(i=1; i < count; i++){
+		for(j=i; (j > 0) && (spans[j].point.x < spans[j-1].point.x); j--){
+			tmp = spans[j];
+			spans[j] = spans[j-1];
+			spans[j-1] = tmp;
+		}
+	}
+
+	merged = 0;
+	i = 0;
+	while( i < count ){
+		end = spans[i].point.x + spans[i].area.width;
+		for(j=i+1; (j < count) && (spans[j].point.x <= end); j++){
+			if( spans[j].point.x + spans[j].area.width > end ){
+				end = spans[j].point.x + spans[j].area.width;
+			}
+		}
+		spans[merged].point.x = spans[i].point.x;
+		spans[merged].area.width = end - spans[i].point.x;
+		merged++;
+		i = j;
+	}
+	return merged;
+}
+
+//draws sorted spans that don't overlap on the row that starts at row
+void draw_merged_spans(const sg_bmap_t * bmap, sg_bmap_data_t * row, const sg_region_t * spans, sg_int_t count){
+	const u32 bits_per_pixel = SG_BITS_PER_PIXEL_VALUE(bmap);
+	sg_pen_rop_t pen_rop;
+	sg_cursor_t cursor;
+	sg_int_t i;
+	u32 start_bit;
+	u32 end_bit;
+
+	sg_pen_rop_init(&pen_rop, bmap);
+	if( pen_rop.is_zero_transparent && (pen_rop.pattern == 0) ){
+		return;
+	}
+
+	cursor.bmap = bmap;
+	for(i=0; i < count; i++){
+		start_bit = spans[i].point.x * bits_per_pixel;
+		end_bit = start_bit + spans[i].area.width * bits_per_pixel;
+		if( (start_bit / SG_BITS_PER_WORD) == ((end_bit - 1) / SG_BITS_PER_WORD) ){
+			//short spans (common at the edges of shapes) are a single masked word
+			pen_rop.draw_word(
+						row + start_bit / SG_BITS_PER_WORD,
+						pen_rop.pattern,
+						(sg_bmap_data_t)(((u64)1 << (end_bit - start_bit)) - 1) << (start_bit % SG_BITS_PER_WORD)
+						);
+		} else {
+			cursor.target = row + start_bit / SG_BITS_PER_WORD;
+			cursor.shift = start_bit % SG_BITS_PER_WORD;
+			sg_cursor_draw_pattern(&cursor, spans[i].area.width, pen_rop.pattern);
+		}
+	}
+}
+
+//clips spans to the width of the bitmap and returns the number that are still visible
+sg_int_t clip_row_spans(const sg_bmap_t * bmap, sg_region_t * spans, sg_int_t count){
+	sg_int_t i;
+	sg_int_t visible = 0;
+	s32 x_min;
+	s32 x_max;
+
+	for(i=0; i < count; i++){
+		x_min = spans[i].point.x;
+		x_max = x_min + spans[i].area.width - 1;
+		if( x_min < 0 ){ x_min = 0; }
+		if( x_max >= bmap->area.width ){ x_max = bmap->area.width - 1; }
+		if( x_max >= x_min ){
+			spans[visible].point.x = x_min;
+			spans[visible].area.width = x_max - x_min + 1;
+			visible++;
+		}
+	}
+	return visible;
+}
+
+//quotient rounded toward negative infinity (divisor is positive)
+s64 floor_divide(s64 dividend, s64 divisor){
+	if( dividend < 0 ){
+		return -((divisor - 1 - dividend) / divisor);
+	}
+	return dividend / divisor;
+}
+
+void sg_draw_arc(const sg_bmap_t * bmap, const sg_region_t * region, s16 start, s16 end, s16 rotation, sg_point_t * corners){
+	sg_size_t thickness;
+	sg_point_t center;
+	arc_sector_t sector;
+	s32 rx;
+	s32 ry;
+	s32 half_thick;
+
+	if( is_line_dashed(bmap) ){
+		draw_arc_dashed(bmap, region, start, end, rotation, corners);
+		return;
+	}
+
+	thickness = bmap->pen.thickness;
+	if( thickness == 0 ){
+		thickness = 1;
+	}
+
+	rx = region->area.width/2 - thickness/2;
+	ry = region->area.height/2 - thickness/2;
+
+	//when the pen is as thick as the ellipse is tall (or wide), the center row's pixels
+	//are all on the axis so the sector can't tell them apart (and keeps the center)
+	if( ((rotation % SG_TRIG_POINTS) != 0) ||
+			(((rx <= thickness) || (ry <= thickness)) && (end - start < SG_TRIG_POINTS)) ){
+		draw_arc_rotated(bmap, region, start, end, rotation, corners);
+		return;
+	}
+	center.x = region->point.x + region->area.width/2;
+	center.y = region->point.y + region->area.height/2;
+	half_thick = thickness/2;
+
+	if( corners ){
+		corners[0].x = SG_MAX;
+		corners[0].y = SG_MAX;
+		corners[1].x = SG_MIN;
+		corners[1].y = SG_MIN;
+	}
+
+	if( init_arc_sector(&sector, start, end, rx, ry) ){
+		//the rings are drawn as an annulus from the innermost to the outermost ring
+		draw_arc_rows(
+					bmap,
+					center,
+					rx + thickness - 1 - half_thick,
+					ry + thickness - 1 - half_thick,
+					rx - half_thick,
+					ry - half_thick,
+					&sector,
+					corners
+					);
+	}
+}
+
+/*
+ * Draws the pixels of an ellipse that are between the outer ellipse
+ * and the inner ellipse (including the edge of the inner ellipse).
+ *
+ * The rows are walked from the top to the center with midpoint
+ * ellipse steps and each row is mirrored about the center. The spans
+ * of each row are limited to the sector and drawn using word fills.
+ * If the inner ellipse has a negative radius, the ellipse is filled.
+ *
+ */
+void draw_arc_rows(const sg_bmap_t * bmap, sg_point_t center, s32 rx_outer, s32 ry_outer, s32 rx_inner, s32 ry_inner, const arc_sector_t * sector, sg_point_t * corners){
+	ellipse_t outer;
+	ellipse_t inner;
+	sg_region_t spans[4];
+	sg_int_t span_count;
+	sg_int_t i;
+	s32 row;
+	s32 y;
+	s32 outer_width;
+	s32 inner_above;
+	s32 inner_width;
+	s32 inner_below;
+	s32 inside;
+	int side;
+
+	if( (rx_outer < 0) || (ry_outer < 0) ){
+		return;
+	}
+
+	if( (rx_inner < 0) || (ry_inner < 0) ){
+		rx_inner = -1;
+		ry_inner = -1;
+	}
+
+	ellipse_start(&outer, rx_outer, ry_outer);
+	ellipse_start(&inner, rx_inner, ry_inner);
+	inner_above = -1;
+	inner_width = ellipse_half_width(&inner, ry_outer);
+
+	for(row = ry_outer; row >= 0; row--){
+		outer_width = ellipse_half_width(&outer, row);
+		inner_below = row > 0 ? ellipse_half_width(&inner, row-1) : inner_above;
+
+		//pixels inside the inner ellipse that don't touch its edge
+		inside = inner_width - 1;
+		if( inner_above < inside ){ inside = inner_above; }
+		if( inner_below < inside ){ inside = inner_below; }
+
+		for(side = -1; side <= 1; side += 2){
+			if( (row == 0) && (side > 0) ){
+				break;
+			}
+			y = center.y + side*row;
+
+			span_count = calc_arc_row_spans(sector, center, y, outer_width, inside, spans);
+			if( span_count == 0 ){
+				continue;
+			}
+
+			if( corners ){
+				for(i=0; i < span_count; i++){
+					if( spans[i].point.x < corners[0].x ){ corners[0].x = spans[i].point.x; }
+					if( spans[i].point.x + spans[i].area.width - 1 > corners[1].x ){ corners[1].x = spans[i].point.x + spans[i].area.width - 1; }
+				}
+				if( y < corners[0].y ){ corners[0].y = y; }
+				if( y > corners[1].y ){ corners[1].y = y; }
+			}
+
+			if( (y >= 0) && (y < bmap->area.height) ){
+				draw_row_spans(bmap, y, spans, clip_row_spans(bmap, spans, span_count));
+			}
+		}
+
+		inner_above = inner_width;
+		inner_width = inner_below;
+	}
+}
+
+//spans of row y that are within outer but not within inside of center and in the sector
+sg_int_t calc_arc_row_spans(const arc_sector_t * sector, sg_point_t center, s32 y, s32 outer, s32 inside, sg_region_t * spans){
+	sg_region_t parts[2];
+	sg_int_t part_count;
+	sg_int_t count;
+	sg_int_t i;
+	const s64 dy = (s64)(y - center.y)*sector->scale_y;
+	const s64 limit = (s64)1<<62;
+
+	if( outer < 0 ){
+		return 0;
+	}
+
+	if( inside < 0 ){
+		parts[0].point.x = center.x - outer;
+		parts[0].area.width = 2*outer + 1;
+		part_count = 1;
+	} else if( inside < outer ){
+		parts[0].point.x = center.x - outer;
+		parts[0].area.width = outer - inside;
+		parts[1].point.x = center.x + inside + 1;
+		parts[1].area.width = outer - inside;
+		part_count = 2;
+	} else {
+		return 0;
+	}
+
+	count = 0;
+	for(i=0; i < part_count; i++){
+		if( sector->is_full ){
+			spans[count++] = parts[i];
+			continue;
+		}
+
+		//cross(start, v) >= 0 where v = ((x - center.x)*scale_x, (y - center.y)*scale_y)
+		spans[count] = parts[i];
+		clip_span(spans + count, -sector->start_y*sector->scale_x, sector->start_x*dy + sector->start_y*sector->scale_x*center.x, 0, limit);
+
+		if( sector->is_reflex ){
+			//more than half of the ellipse is in either half plane
+			if( spans[count].area.width ){ count++; }
+			spans[count] = parts[i];
+		}
+
+		//cross(v, end) >= 0
+		clip_span(spans + count, sector->end_y*sector->scale_x, -sector->end_x*dy - sector->end_y*sector->scale_x*center.x, 0, limit);
+		if( spans[count].area.width ){ count++; }
+	}
+
+	return count;
+}
+
+//returns zero if the sector is empty
+int init_arc_sector(arc_sector_t * sector, s16 start, s16 end, s32 rx, s32 ry){
+	sg_point_t direction;
+	s32 sweep = end - start;
+
+	memset(sector, 0, sizeof(arc_sector_t));
+	if( sweep <= 0 ){
+		return 0;
+	}
+
+	if( sweep >= SG_TRIG_POINTS ){
+		sector->is_full = 1;
+		return 1;
+	}
+	sector->is_reflex = sweep > SG_TRIG_POINTS/2;
+
+	//angles are parametric so x offsets are scaled by ry and y offsets by rx
+	sector->scale_x = ry > 0 ? ry : 1;
+	sector->scale_y = rx > 0 ? rx : 1;
+
+	start = start % SG_TRIG_POINTS;
+	if( start < 0 ){ start += SG_TRIG_POINTS; }
+	end = end % SG_TRIG_POINTS;
+	if( end < 0 ){ end += SG_TRIG_POINTS; }
+
+	sg_point_arc(&direction, SG_MAX, SG_MAX, start);
+	sector->start_x = direction.x;
+	sector->start_y = direction.y;
+	sg_point_arc(&direction, SG_MAX, SG_MAX, end);
+	sector->end_x = direction.x;
+	sector->end_y = direction.y;
+	return 1;
+}
+
+void ellipse_start(ellipse_t * ellipse, s32 rx, s32 ry){
+	const u64 width = 2*rx + 1;
+	const u64 height = 2*ry + 1;
+	ellipse->rx = rx;
+	ellipse->ry = ry;
+	ellipse->row = ry;
+	ellipse->x = 0;
+	ellipse->test = 4*height*height;
+	ellipse->threshold = width*width*(4*(u64)ry + 1);
+	ellipse_half_width(ellipse, ry);
+}
+
+//half width of row (distance from the center) or -1 if the row is outside
+s32 ellipse_half_width(ellipse_t * ellipse, s32 row){
+	const u64 width = 2*ellipse->rx + 1;
+	const u64 height = 2*ellipse->ry + 1;
+
+	if( row < 0 ){
+		row = -row;
+	}
+
+	if( (row > ellipse->ry) || (ellipse->ry < 0) ){
+		return -1;
+	}
+
+	//toward the center the rows get wider
+	while( ellipse->row > row ){
+		ellipse->threshold += 4*width*width*(2*ellipse->row - 1);
+		ellipse->row--;
+	}
+
+	while( (ellipse->x < ellipse->rx) && (ellipse->test <= ellipse->threshold) ){
+		ellipse->test += 4*height*height*(2*ellipse->x + 3);
+		ellipse->x++;
+	}
+
+	//away from the center they get narrower
+	while( ellipse->row < row ){
+		ellipse->row++;
+		ellipse->threshold -= 4*width*width*(2*ellipse->row - 1);
+	}
+
+	while( (ellipse->x > 0) && (ellipse->test - 4*height*height*(2*ellipse->x + 1) > ellipse->threshold) ){
+		ellipse->test -= 4*height*height*(2*ellipse->x + 1);
+		ellipse->x--;
+	}
+
+	return ellipse->x;
+}
+
+void sg_draw_circle_filled(const sg_bmap_t * bmap, sg_point_t center, sg_size_t radius){
+	arc_sector_t sector;
+	init_arc_sector(&sector, 0, SG_TRIG_POINTS, radius, radius);
+	draw_arc_rows(bmap, center, radius, radius, -1, -1, &sector, 0);
+}
+
+/*
+ * Draws a rectangle with rounded corners
+ *
+ * Each row is solved for the left and right edge using the corner
+ * ellipse walks. The outline is the filled shape less the inside of
+ * the shape inset by the pen thickness (pixels on the edge of the inset
+ * shape are part of the outline so thin outlines have no gaps).
+ *
+ */
+void sg_draw_round_rect(const sg_bmap_t * bmap, const sg_region_t * region, const sg_corner_radii_t * radii, int is_filled){
+	round_rect_t outer;
+	round_rect_t inner;
+	sg_region_t spans[2];
+	sg_int_t span_count;
+	s32 radius[4];
+	s32 inner_radius[4];
+	s32 limit;
+	s32 inset;
+	s32 y;
+	s32 y_max;
+	s32 left;
+	s32 right;
+	s32 inner_left[3];
+	s32 inner_right[3];
+	s32 inside_left;
+	s32 inside_right;
+	int is_outline;
+	int i;
+
+	inset = bmap->pen.thickness > 1 ? bmap->pen.thickness - 1 : 0;
+	limit = (region->area.width < region->area.height ? region->area.width : region->area.height) / 2;
+	radius[0] = radii ? radii->top_left : 0;
+	radius[1] = radii ? radii->top_right : 0;
+	radius[2] = radii ? radii->bottom_right : 0;
+	radius[3] = radii ? radii->bottom_left : 0;
+	for(i=0; i < 4; i++){
+		if( radius[i] > limit ){ radius[i] = limit; }
+		inner_radius[i] = radius[i] > inset ? radius[i] - inset : 0;
+	}
+
+	if( init_round_rect(
+				&outer,
+				region->point.x,
+				region->point.y,
+				region->point.x + region->area.width - 1,
+				region->point.y + region->area.height - 1,
+				radius) == 0 ){
+		return;
+	}
+
+	is_outline = (is_filled == 0) && init_round_rect(
+				&inner,
+				outer.left + inset,
+				outer.top + inset,
+				outer.right - inset,
+				outer.bottom - inset,
+				inner_radius);
+
+	y = outer.top > 0 ? outer.top : 0;
+	y_max = outer.bottom < bmap->area.height ? outer.bottom : bmap->area.height - 1;
+
+	if( is_outline ){
+		calc_round_rect_span(&inner, y - 1, inner_left + 1, inner_right + 1);
+		calc_round_rect_span(&inner, y, inner_left + 2, inner_right + 2);
+	}
+
+	for(; y <= y_max; y++){
+		calc_round_rect_span(&outer, y, &left, &right);
+		inside_left = 1;
+		inside_right = 0;
+
+		if( is_outline ){
+			for(i=0; i < 2; i++){
+				inner_left[i] = inner_left[i+1];
+				inner_right[i] = inner_right[i+1];
+			}
+			calc_round_rect_span(&inner, y + 1, inner_left + 2, inner_right + 2);
+
+			//pixels of the inset shape that don't touch its edge
+			inside_left = inner_left[1] + 1;
+			inside_right = inner_right[1] - 1;
+			for(i=0; i < 3; i += 2){
+				if( inner_left[i] > inside_left ){ inside_left = inner_left[i]; }
+				if( inner_right[i] < inside_right ){ inside_right = inner_right[i]; }
+			}
+		}
+
+		spans[0].point.x = left;
+		if( inside_left > inside_right ){
+			spans[0].area.width = right - left + 1;
+			span_count = 1;
+		} else {
+			spans[0].area.width = inside_left - left;
+			spans[1].point.x = inside_right + 1;
+			spans[1].area.width = right - inside_right;
+			span_count = 2;
+		}
+
+		draw_row_spans(bmap, y, spans, clip_row_spans(bmap, spans, span_count));
+	}
+}
+
+//returns zero if the rectangle is empty
+int init_round_rect(round_rect_t * shape, s32 left, s32 top, s32 right, s32 bottom, const s32 * radius){
+	int i;
+	if( (right < left) || (bottom < top) ){
+		return 0;
+	}
+
+	shape->left = left;
+	shape->top = top;
+	shape->right = right;
+	shape->bottom = bottom;
+	for(i=0; i < 4; i++){
+		shape->radius[i] = radius[i];
+		ellipse_start(shape->corner + i, radius[i], radius[i]);
+	}
+	return 1;
+}
+
+//left and right edges of row y (left is greater than right if the row is outside)
+void calc_round_rect_span(round_rect_t * shape, s32 y, s32 * left, s32 * right){
+	const s32 * radius = shape->radius;
+	s32 row;
+
+	if( (y < shape->top) || (y > shape->bottom) ){
+		*left = 1;
+		*right = 0;
+		return;
+	}
+
+	*left = shape->left;
+	*right = shape->right;
+
+	row = y - shape->top;
+	if( row < radius[0] ){ *left += radius[0] - ellipse_half_width(shape->corner + 0, radius[0] - row); }
+	if( row < radius[1] ){ *right -= radius[1] - ellipse_half_width(shape->corner + 1, radius[1] - row); }
+
+	row = shape->bottom - y;
+	if( row < radius[2] ){ *right -= radius[2] - ellipse_half_width(shape->corner + 2, radius[2] - row); }
+	if( row < radius[3] ){ *left += radius[3] - ellipse_half_width(shape->corner + 3, radius[3] - row); }
+}
+
+void sg_draw_triangle_filled(const sg_bmap_t * bmap, sg_point_t p1, sg_point_t p2, sg_point_t p3){
+	sg_point_t points[3];
+	points[0] = p1;
+	points[1] = p2;
+	points[2] = p3;
+	sg_draw_polygon_filled(bmap, points, 3);
+}
+
+/*
+ * Fills a convex polygon one row at a time
+ *
+ * The two chains of edges between the top and bottom vertices are walked
+ * down together. Because the polygon is convex, each row is a single
+ * span from the leftmost to the rightmost edge pixel on that row, so the
+ * rows are filled without reading the bitmap.
+ *
+ */
+void sg_draw_polygon_filled(const sg_bmap_t * bmap, const sg_point_t * points, u32 count){
+	polygon_chain_t chains[2];
+	sg_region_t span;
+	u32 top = 0;
+	u32 bottom = 0;
+	u32 i;
+	s32 y;
+	s32 left;
+	s32 right;
+
+	if( count == 0 ){
+		return;
+	}
+
+	for(i=1; i < count; i++){
+		if( points[i].y < points[top].y ){ top = i; }
+		//the last lowest point so a flat polygon still has two chains
+		if( points[i].y >= points[bottom].y ){ bottom = i; }
+	}
+
+	for(i=0; i < 2; i++){
+		chains[i].direction = i ? -1 : 1;
+		chains[i].point = top;
+		init_edge_walker(&chains[i].edge, points[top], points[top], 0);
+	}
+
+	for(y = points[top].y; y <= points[bottom].y; y++){
+		if( y >= bmap->area.height ){
+			return;
+		}
+
+		left = SG_MAX;
+		right = SG_MIN;
+		add_polygon_chain_row(chains + 0, points, count, bottom, &left, &right);
+		add_polygon_chain_row(chains + 1, points, count, bottom, &left, &right);
+
+		if( y >= 0 ){
+			if( left < 0 ){ left = 0; }
+			if( right >= bmap->area.width ){ right = bmap->area.width - 1; }
+			if( left <= right ){
+				span.point.x = left;
+				span.area.width = right - left + 1;
+				draw_row_spans(bmap, y, &span, 1);
+			}
+		}
+	}
+}
+
+//widens left and right to include the chain's pixels on the current row then moves the chain to the next row
+void add_polygon_chain_row(polygon_chain_t * chain, const sg_point_t * points, u32 count, u32 bottom, s32 * left, s32 * right){
+	edge_walker_t * edge = &chain->edge;
+	u32 next;
+
+	for(;;){
+		if( edge->step_x > 0 ){
+			if( edge->x + (s32)edge->first < *left ){ *left = edge->x + edge->first; }
+			if( edge->x + (s32)edge->last > *right ){ *right = edge->x + edge->last; }
+		} else {
+			if( edge->x - (s32)edge->last < *left ){ *left = edge->x - edge->last; }
+			if( edge->x - (s32)edge->first > *right ){ *right = edge->x - edge->first; }
+		}
+
+		if( edge->y < edge->y_end ){
+			advance_edge_walker(edge);
+			return;
+		}
+
+		if( chain->point == bottom ){
+			return;
+		}
+
+		//the next edge starts on this row (edges are drawn from the lower index to the higher one)
+		next = (chain->point + count + chain->direction) % count;
+		init_edge_walker(edge, points[chain->point], points[next], chain->direction < 0);
+		chain->point = next;
+	}
+}
 
-	if( p2.y > p1.y ){
-		dy = 1;
-	} else {
-		dy = -1;
+/*
+ * Starts walking from top to bottom. If is_reversed is set, the pixels
+ * match a line drawn from bottom to top (halfway cases round the other way).
+ *
+ */
+void init_edge_walker(edge_walker_t * edge, sg_point_t top, sg_point_t bottom, int is_reversed){
+	const s32 dx = bottom.x - top.x;
+	const u32 bias = is_reversed ? 1 : 0;
+	u32 dy;
+
+	//an edge that goes up (the polygon isn't convex) is treated as flat
+	if( bottom.y < top.y ){
+		bottom.y = top.y;
+	}
+	dy = bottom.y - top.y;
+
+	edge->x = top.x;
+	edge->y = top.y;
+	edge->y_end = bottom.y;
+	edge->step_x = dx < 0 ? -1 : 1;
+	edge->length = abs_value(dx);
+	edge->first = 0;
+	edge->is_steep = dy > edge->length;
+
+	if( dy == 0 ){
+		edge->last = edge->length;
+		return;
 	}
 
-	if( p2.x > p1.x ){
-		dx = 1;
+	//a thin line puts step i on row (2*i*dy + length - bias) / (2*length) (or the transpose if steep)
+	edge->divisor = 2*dy;
+	edge->quotient_step = (2*edge->length) / edge->divisor;
+	edge->remainder_step = (2*edge->length) % edge->divisor;
+	if( edge->is_steep ){
+		//offset of row r is (2*r*length + dy - bias) / (2*dy)
+		edge->quotient = 0;
+		edge->remainder = dy - bias;
+		edge->last = 0;
 	} else {
-		dx = -1;
+		//row r ends before the offset ceil((length*(2*r + 1) + bias) / (2*dy))
+		edge->quotient = (edge->length + bias + edge->divisor - 1) / edge->divisor;
+		edge->remainder = (edge->length + bias + edge->divisor - 1) % edge->divisor;
+		edge->last = edge->quotient - 1;
 	}
+}
 
-	adx = abs_value(p2.x - p1.x);
-	ady = abs_value(p2.y - p1.y);
-	rise = (p2.y - p1.y);
-	run = (p2.x - p1.x);
-
-	region.point.x = p1.x;
-	region.point.y = p1.y;
-	if( adx > ady ){
+void advance_edge_walker(edge_walker_t * edge){
+	u32 start = edge->quotient;
 
-		while(region.point.x != p2.x ){
-			for(i=0; i < thickness; i++){
-				tmp.point = region.point.point;
-				tmp.y = region.point.y - half_thick + i;
-				sg_draw_pixel(bmap, tmp);
-			}
-			region.point.x += dx;
-			region.point.y = ((region.point.x - p1.x) * rise + dy*run/2) / run + p1.y;
-		}
-	} else {
-		while(region.point.y != p2.y ){
-			for(i=0; i < thickness; i++){
-				tmp.point = region.point.point;
-				tmp.x = region.point.x - half_thick + i;
-				sg_draw_pixel(bmap, tmp);
-			}
-			region.point.y += dy;
-			region.point.x = ((region.point.y - p1.y) * run + dx*rise/2) / rise + p1.x;
-		}
+	edge->y++;
+	edge->quotient += edge->quotient_step;
+	edge->remainder += edge->remainder_step;
+	if( edge->remainder >= edge->divisor ){
+		edge->remainder -= edge->divisor;
+		edge->quotient++;
 	}
 
-	if( adx <= ady ){
-		for(i=0; i < thickness; i++){
-			tmp.point = p2.point;
-			tmp.x = p2.x - half_thick + i;
-			sg_draw_pixel(bmap, tmp);
-		}
+	if( edge->is_steep ){
+		edge->first = edge->quotient;
+		edge->last = edge->quotient;
 	} else {
-		for(i=0; i < thickness; i++){
-			tmp.point = p2.point;
-			tmp.y = p2.y - half_thick + i;
-			sg_draw_pixel(bmap, tmp);
+		edge->first = start;
+		edge->last = edge->quotient - 1;
+		if( edge->last > edge->length ){
+			edge->last = edge->length;
 		}
 	}
 }
 
-u16 calc_largest_delta(sg_point_t p0, sg_point_t p1){
-	s16 dx; s16 dy;
-	dx = p0.x - p1.x;
-	dy = p0.y - p1.y;
-
-	dx = dx < 0 ? dx*-1 : dx;
-	dy = dy < 0 ? dy*-1 : dy;
+//samples the arc at each angle (used when the arc is rotated or very flat)
+void draw_arc_rotated(const sg_bmap_t * bmap, const sg_region_t * region, s16 start, s16 end, s16 rotation, sg_point_t * corners){
 
-	return (dx > dy) ? dx : dy;
-
-}
-
-void sg_draw_arc(const sg_bmap_t * bmap, const sg_region_t * region, s16 start, s16 end, s16 rotation, sg_point_t * corners){
 	sg_size_t half_thick;
 	sg_size_t thickness;
 	sg_point_t pen;
@@ -161,8 +2181,8 @@ void sg_draw_arc(const sg_bmap_t * bmap, const sg_region_t * region, s16 start,
 	sg_point_t p;
 	sg_area_t d;
 	sg_point_t min, max;
-	sg_size_t rx;
-	sg_size_t ry;
+	s32 rx;
+	s32 ry;
 
 	p = region->point;
 	d = region->area;
@@ -189,7 +2209,8 @@ void sg_draw_arc(const sg_bmap_t * bmap, const sg_region_t * region, s16 start,
 	for(t=0; t < thickness; t++){
 		thick =  t - half_thick;
 		for(i=start; i < end; i++){
-			sg_point_arc(&pen, rx + thick, ry + thick, i);
+			//rings inside the center are drawn at the center
+			sg_point_arc(&pen, rx + thick > 0 ? rx + thick : 0, ry + thick > 0 ? ry + thick : 0, i);
 			if( i == 0 || (pen.point != last_point.point) ){
 				last_point.point = pen.point;
 				sg_point_rotate(&pen, rotation);
@@ -213,134 +2234,240 @@ void sg_draw_arc(const sg_bmap_t * bmap, const sg_region_t * region, s16 start,
 
 }
 
-void sg_draw_quadratic_bezier(const sg_bmap_t * bmap, sg_point_t p0, sg_point_t p1, sg_point_t p2, sg_point_t * corners){
-	u32 i;
-	s32 x;
-	s32 y;
-	u32 steps;
-	u32 steps2;
-	sg_point_t current;
-	sg_point_t last;
-	sg_point_t min, max;
-
-	steps = calc_largest_delta(p0, p1);
-	steps += calc_largest_delta(p1, p2);
-	steps2 = steps*steps;
+/*
+ * Draws an arc as a polyline so the dash pattern follows the curve
+ *
+ * The angle step keeps the chords within about half a pixel of the
+ * ellipse (r*(1 - cos(a/2)) <= 1/2 so a <= 2/sqrt(r) radians).
+ *
+ */
+void draw_arc_dashed(const sg_bmap_t * bmap, const sg_region_t * region, s16 start, s16 end, s16 rotation, sg_point_t * corners){
+	sg_polyline_t polyline;
+	sg_size_t thickness;
+	sg_point_t center;
+	sg_point_t p;
+	s32 rx;
+	s32 ry;
+	s32 step;
+	s32 angle;
+	s32 last;
 
-	if( steps2 == 0 ){
-		return;
+	thickness = bmap->pen.thickness;
+	if( thickness == 0 ){
+		thickness = 1;
 	}
 
+	rx = region->area.width/2 - thickness/2;
+	ry = region->area.height/2 - thickness/2;
+	center.x = region->point.x + region->area.width/2;
+	center.y = region->point.y + region->area.height/2;
+
 	if( corners ){
-		min.x = SG_MAX;
-		min.y = SG_MAX;
-		max.x = SG_MIN;
-		max.y = SG_MIN;
+		corners[0].x = SG_MAX;
+		corners[0].y = SG_MAX;
+		corners[1].x = SG_MIN;
+		corners[1].y = SG_MIN;
 	}
 
-	//t goes from zero to one
-	for(i=0; i < steps; i++){
-		//(1-t)^2*P0 + 2*(1-t)*t*P2 + t^2*P2
+	if( (end <= start) || (rx < 0) || (ry < 0) ){
+		return;
+	}
+
+	last = end;
+	if( last - start > SG_TRIG_POINTS ){
+		last = start + SG_TRIG_POINTS;
+	}
 
-		if( i < steps ){
-			x = (steps - i)*(steps - i)*p0.x + 2*(steps - i)*i*p1.x + i*i*p2.x;
-			y = (steps - i)*(steps - i)*p0.y + 2*(steps - i)*i*p1.y + i*i*p2.y;
+	//SG_TRIG_POINTS/(pi*sqrt(r)) table steps
+	step = (SG_TRIG_POINTS*7) / (22*calc_sqrt_ceiling((rx > ry ? rx : ry) + 1));
+	if( step < 1 ){
+		step = 1;
+	}
 
-			current.x = x / (steps2);
-			current.y = y / (steps2);
+	sg_polyline_start(&polyline, bmap);
+	for(angle = start; ; angle += step){
+		if( angle > last ){
+			angle = last;
 		}
 
+		sg_point_arc(&p, rx, ry, ((angle % SG_TRIG_POINTS) + SG_TRIG_POINTS) % SG_TRIG_POINTS);
+		sg_point_rotate(&p, rotation);
+		sg_point_shift(&p, center);
+		sg_polyline_add(&polyline, p);
+
 		if( corners ){
-			if( current.x < min.x ){ min.x = current.x; }
-			if( current.y < min.y ){ min.y = current.y; }
-			if( current.x > max.x ){ max.x = current.x; }
-			if( current.y > max.y ){ max.y = current.y; }
+			if( p.x - thickness/2 < corners[0].x ){ corners[0].x = p.x - thickness/2; }
+			if( p.y - thickness/2 < corners[0].y ){ corners[0].y = p.y - thickness/2; }
+			if( p.x + (thickness-1)/2 > corners[1].x ){ corners[1].x = p.x + (thickness-1)/2; }
+			if( p.y + (thickness-1)/2 > corners[1].y ){ corners[1].y = p.y + (thickness-1)/2; }
 		}
 
-		if( i != 0 ){
-			sg_draw_line(bmap, current, last);
+		if( angle == last ){
+			break;
 		}
-		last.point = current.point;
 	}
+	sg_polyline_finish(&polyline);
+}
 
-	sg_draw_line(bmap, last, p2);
+void sg_draw_quadratic_bezier(const sg_bmap_t * bmap, sg_point_t p0, sg_point_t p1, sg_point_t p2, sg_point_t * corners){
+	sg_point_t points[4];
+	points[0] = p0;
+	points[1] = p1;
+	points[2] = p2;
+	points[3] = p2;
+	draw_bezier(bmap, points, 0, corners);
+}
 
-	if( corners ){
-		//update corners with min/max values
-		corners[0] = min;
-		corners[1] = max;
-	}
+void sg_draw_cubic_bezier(const sg_bmap_t * bmap, sg_point_t p0, sg_point_t p1, sg_point_t p2, sg_point_t p3, sg_point_t * corners){
+	sg_point_t points[4];
+	points[0] = p0;
+	points[1] = p1;
+	points[2] = p2;
+	points[3] = p3;
+	draw_bezier(bmap, points, 1, corners);
+}
 
+void draw_bezier(const sg_bmap_t * bmap, const sg_point_t * points, int is_cubic, sg_point_t * corners){
+	sg_polyline_t polyline;
+	sg_point_t bounds[2];
 
+	bounds[0] = points[0];
+	bounds[1] = points[0];
+	sg_polyline_start(&polyline, bmap);
+	sg_polyline_add_bezier(&polyline, points, is_cubic, bounds);
+	sg_polyline_finish(&polyline);
+
+	if( corners ){
+		corners[0] = bounds[0];
+		corners[1] = bounds[1];
+	}
 }
 
-void sg_draw_cubic_bezier(const sg_bmap_t * bmap, sg_point_t p0, sg_point_t p1, sg_point_t p2, sg_point_t p3, sg_point_t * corners){
-	u32 i;
-	s32 x;
-	s32 y;
-	u32 steps;
-	u32 steps3;
+//adds a flattened bezier curve to the polyline (see sg_bezier_start())
+void sg_polyline_add_bezier(sg_polyline_t * polyline, const sg_point_t * points, int is_cubic, sg_point_t * corners){
+	sg_bezier_t bezier;
 	sg_point_t current;
-	sg_point_t last;
-	sg_point_t min, max;
 
-	//calc distance to determine number of steps
-	steps = calc_largest_delta(p0, p1);
-	steps += calc_largest_delta(p1, p2);
-	steps += calc_largest_delta(p2, p3);
+	sg_bezier_start(&bezier, points, is_cubic);
+	sg_polyline_add(polyline, points[0]);
+	while( sg_bezier_next(&bezier, &current) ){
+		if( current.x < corners[0].x ){ corners[0].x = current.x; }
+		if( current.y < corners[0].y ){ corners[0].y = current.y; }
+		if( current.x > corners[1].x ){ corners[1].x = current.x; }
+		if( current.y > corners[1].y ){ corners[1].y = current.y; }
 
-	steps3 = steps*steps*steps;
-	if( steps3 == 0 ){
-		return;
+		sg_polyline_add(polyline, current);
 	}
+}
 
-	if( corners ){
-		min.x = SG_MAX;
-		min.y = SG_MAX;
-		max.x = SG_MIN;
-		max.y = SG_MIN;
-	}
+/*
+ * Prepares to flatten a quadratic (points[0] to points[2]) or cubic
+ * bezier curve into line segments
+ *
+ * The number of segments comes from the curve's second differences so
+ * that no point of a segment is more than half a pixel from the curve
+ * (Wang's bound). The points are then stepped with forward differences
+ * in fixed point so each point costs a few additions.
+ *
+ */
+void sg_bezier_start(sg_bezier_t * bezier, const sg_point_t * points, int is_cubic){
+	u64 flatness;
+	u32 segments;
+	u32 i;
 
-	//t goes from zero to one
-	for(i=0; i < steps; i++){
+	if( is_cubic ){
+		flatness = calc_bezier_flatness(points[0], points[1], points[2]);
+		i = calc_bezier_flatness(points[1], points[2], points[3]);
+		if( i > flatness ){ flatness = i; }
+		//n^2 >= 3/4 * flatness / tolerance
+		flatness = 3*flatness;
+	} else {
+		//n^2 >= 1/4 * flatness / tolerance
+		flatness = calc_bezier_flatness(points[0], points[1], points[2]);
+	}
 
-		if( i < steps ){
-			x = (steps-i)*(steps-i)*(steps-i)*p0.x +
-					3*(steps-i)*(steps-i)*i*p1.x +
-					3*(steps-i)*i*i*p2.x +
-					i*i*i*p3.x;
+	//with a tolerance of half a pixel
+	segments = calc_sqrt_ceiling((flatness + 1) / 2);
+	if( segments == 0 ){
+		segments = 1;
+	} else if( segments > DRAW_BEZIER_MAX_SEGMENTS ){
+		segments = DRAW_BEZIER_MAX_SEGMENTS;
+	}
 
-			y = (steps-i)*(steps-i)*(steps-i)*p0.y +
-					3*(steps-i)*(steps-i)*i*p1.y +
-					3*(steps-i)*i*i*p2.y +
-					i*i*i*p3.y;
+	//a quadratic curve doesn't use p3 (it only needs three points)
+	bezier->end = points[is_cubic ? 3 : 2];
+	init_bezier_axis(bezier->axis + 0, points[0].x, points[1].x, points[2].x, bezier->end.x, is_cubic, segments);
+	init_bezier_axis(bezier->axis + 1, points[0].y, points[1].y, points[2].y, bezier->end.y, is_cubic, segments);
+	bezier->segments = segments;
+	bezier->step = 0;
+}
 
-			current.x = x / (steps3);
-			current.y = y / (steps3);
-		}
+//gets the end of the next segment (returns zero after the end of the curve)
+int sg_bezier_next(sg_bezier_t * bezier, sg_point_t * p){
+	if( bezier->step == bezier->segments ){
+		return 0;
+	}
 
-		if( corners ){
-			if( current.x < min.x ){ min.x = current.x; }
-			if( current.y < min.y ){ min.y = current.y; }
-			if( current.x > max.x ){ max.x = current.x; }
-			if( current.y > max.y ){ max.y = current.y; }
-		}
+	bezier->step++;
+	if( bezier->step == bezier->segments ){
+		//the end point is exact
+		*p = bezier->end;
+	} else {
+		p->x = step_bezier_axis(bezier->axis + 0);
+		p->y = step_bezier_axis(bezier->axis + 1);
+	}
+	return 1;
+}
 
-		if( i != 0 ){
-			sg_draw_line(bmap, current, last);
-		}
+//largest second difference (rounded up) of three control points
+u32 calc_bezier_flatness(sg_point_t p0, sg_point_t p1, sg_point_t p2){
+	s64 dx = p0.x - 2*p1.x + p2.x;
+	s64 dy = p0.y - 2*p1.y + p2.y;
+	return calc_sqrt_ceiling(dx*dx + dy*dy);
+}
 
-		last.point = current.point;
+u32 calc_sqrt_ceiling(u64 value){
+	u32 root = sg_calc_sqrt(value);
+	if( (u64)root*root < value ){
+		root++;
 	}
+	return root;
+}
 
-	sg_draw_line(bmap, last, p3);
-
-	if( corners ){
-		//update corners with min/max values
-		corners[0] = min;
-		corners[1] = max;
+/*
+ * Sets up the forward differences for one axis of the curve in the
+ * power basis a*t^3 + b*t^2 + c*t + p0 with a step of 1/segments.
+ *
+ */
+void init_bezier_axis(sg_bezier_axis_t * axis, s64 p0, s64 p1, s64 p2, s64 p3, int is_cubic, u32 segments){
+	const s64 n = segments;
+	const s64 one = (s64)1 << DRAW_BEZIER_FRACTION_BITS;
+	s64 a;
+	s64 b;
+	s64 c;
+
+	if( is_cubic ){
+		a = -p0 + 3*p1 - 3*p2 + p3;
+		b = 3*p0 - 6*p1 + 3*p2;
+		c = -3*p0 + 3*p1;
+	} else {
+		a = 0;
+		b = p0 - 2*p1 + p2;
+		c = 2*(p1 - p0);
 	}
 
+	axis->value = p0*one + one/2;
+	axis->step3 = 6*a*one / (n*n*n);
+	axis->step2 = axis->step3 + 2*b*one / (n*n);
+	axis->step1 = a*one / (n*n*n) + b*one / (n*n) + c*one / n;
+}
+
+//moves to the next point and returns the coordinate rounded to a pixel
+sg_int_t step_bezier_axis(sg_bezier_axis_t * axis){
+	axis->value += axis->step1;
+	axis->step1 += axis->step2;
+	axis->step2 += axis->step3;
+	return axis->value >> DRAW_BEZIER_FRACTION_BITS;
 }
 
 void sg_draw_rectangle(const sg_bmap_t * bmap, const sg_region_t * region){
@@ -363,6 +2490,234 @@ void sg_draw_rectangle(const sg_bmap_t * bmap, const sg_region_t * region){
 	}
 }
 
+void sg_draw_rectangles(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count){
+	sg_pen_rop_t pen_rop;
+	u32 batch;
+	u32 i;
+
+	sg_pen_rop_init(&pen_rop, bmap);
+	if( is_rop_repeatable(pen_rop.rop) == 0 ){
+		//pixels where rectangles in different batches overlap would be drawn twice
+		draw_rectangle_sweep(bmap, regions, count);
+		return;
+	}
+
+	for(i=0; i < count; i += batch){
+		batch = count - i;
+		if( batch > DRAW_RECTANGLES_BATCH ){
+			batch = DRAW_RECTANGLES_BATCH;
+		}
+		draw_rectangle_batch(bmap, regions + i, batch);
+	}
+}
+
+/*
+ * Fills a group of rectangles band by band
+ *
+ * The rectangles are clipped once and sorted by their top row. A band
+ * is a run of rows where the same rectangles are present, so the spans
+ * are collected and merged once per band. Each row of the band is then
+ * drawn with one pass over the merged spans.
+ *
+ */
+void draw_rectangle_batch(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count){
+	sg_region_t rects[DRAW_RECTANGLES_BATCH];
+	sg_region_t spans[DRAW_RECTANGLES_BATCH];
+	sg_region_t tmp;
+	sg_bmap_data_t * row;
+	sg_point_t p;
+	sg_area_t d;
+	sg_int_t span_count;
+	u32 rect_count = 0;
+	u32 i;
+	u32 j;
+	s32 y;
+	s32 band_end;
+	s32 bottom;
+
+	for(i=0; i < count; i++){
+		p = regions[i].point;
+		d = regions[i].area;
+		if( truncate_visible(bmap, &p, &d) && d.width && d.height ){
+			rects[rect_count].point = p;
+			rects[rect_count].area = d;
+			//insertion sort by the top row
+			for(j = rect_count; (j > 0) && (rects[j].point.y < rects[j-1].point.y); j--){
+				tmp = rects[j];
+				rects[j] = rects[j-1];
+				rects[j-1] = tmp;
+			}
+			rect_count++;
+		}
+	}
+
+	if( rect_count == 0 ){
+		return;
+	}
+
+	y = rects[0].point.y;
+	for(;;){
+		span_count = 0;
+		band_end = SG_MAX + 1;
+		for(i=0; i < rect_count; i++){
+			if( rects[i].point.y > y ){
+				//the band ends where the next rectangle starts
+				if( rects[i].point.y < band_end ){ band_end = rects[i].point.y; }
+				break;
+			}
+
+			bottom = rects[i].point.y + rects[i].area.height;
+			if( bottom > y ){
+				spans[span_count].point.x = rects[i].point.x;
+				spans[span_count].area.width = rects[i].area.width;
+				span_count++;
+				if( bottom < band_end ){ band_end = bottom; }
+			}
+		}
+
+		if( band_end > SG_MAX ){
+			return;
+		}
+
+		span_count = merge_row_spans(spans, span_count);
+		row = bmap->data + y*bmap->columns;
+		for(; y < band_end; y++){
+			draw_merged_spans(bmap, row, spans, span_count);
+			row += bmap->columns;
+		}
+	}
+}
+
+//checks if drawing a pixel again with rop leaves it as drawing it once did
+int is_rop_repeatable(u8 rop){
+	u32 input;
+	u32 once;
+	u32 pattern;
+
+	for(input=0; input < 4; input++){
+		pattern = input >> 1;
+		once = (rop >> input) & 0x01;
+		if( ((rop >> ((pattern << 1) | once)) & 0x01) != once ){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Fills a whole list of rectangles band by band
+ *
+ * This is used when drawing a pixel twice changes it (such as with
+ * SG_PEN_FLAG_IS_INVERT). A band is a run of rows where the same
+ * rectangles are present. The rectangles aren't copied or sorted so any
+ * number of them is merged without running out of room, but each band
+ * costs a scan of the list.
+ *
+ */
+void draw_rectangle_sweep(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count){
+	s32 y = 0;
+
+	while( y < bmap->area.height ){
+		y = draw_rectangle_band(bmap, regions, count, y);
+	}
+}
+
+/*
+ * Draws the band of rectangles that starts on row y and returns where it ends
+ *
+ * The band ends where a rectangle starts or ends. The spans of the
+ * rectangles present on row y are merged so pixels where they overlap
+ * are drawn once. If there are more separate spans than fit, the ones on
+ * the left are drawn first and the rest of the band is done with another
+ * pass (x_limit is where the spans that were left out start).
+ *
+ */
+s32 draw_rectangle_band(const sg_bmap_t * bmap, const sg_region_t * regions, u32 count, s32 y){
+	sg_region_t spans[DRAW_RECTANGLES_SPANS];
+	sg_bmap_data_t * row;
+	sg_int_t span_count;
+	sg_int_t last;
+	sg_int_t j;
+	s32 band_end = bmap->area.height;
+	s32 x = 0;
+	s32 x_limit;
+	s32 left;
+	s32 right;
+	s32 top;
+	s32 bottom;
+	s32 row_y;
+	u32 i;
+
+	do {
+		x_limit = bmap->area.width;
+		span_count = 0;
+		for(i=0; i < count; i++){
+			top = regions[i].point.y;
+			bottom = top + regions[i].area.height;
+			if( (bottom <= y) || (regions[i].area.width == 0) ){
+				continue;
+			}
+
+			if( top > y ){
+				//the band ends where the next rectangle starts
+				if( top < band_end ){ band_end = top; }
+				continue;
+			}
+			if( bottom < band_end ){ band_end = bottom; }
+
+			left = regions[i].point.x;
+			right = left + regions[i].area.width;
+			if( left < x ){ left = x; }
+			if( right > bmap->area.width ){ right = bmap->area.width; }
+			if( (right <= left) || (left >= x_limit) ){
+				continue;
+			}
+
+			if( span_count == DRAW_RECTANGLES_SPANS ){
+				span_count = merge_row_spans(spans, span_count);
+			}
+
+			if( span_count == DRAW_RECTANGLES_SPANS ){
+				//leave the right-most span for the next pass
+				last = 0;
+				for(j=1; j < span_count; j++){
+					if( spans[j].point.x > spans[last].point.x ){ last = j; }
+				}
+				if( left >= spans[last].point.x ){
+					x_limit = left;
+					continue;
+				}
+				x_limit = spans[last].point.x;
+				span_count--;
+				spans[last] = spans[span_count];
+			}
+
+			spans[span_count].point.x = left;
+			spans[span_count].area.width = right - left;
+			span_count++;
+		}
+
+		span_count = merge_row_spans(spans, span_count);
+		//spans that reach past x_limit are finished by the next pass
+		while( (span_count > 0) && (spans[span_count-1].point.x >= x_limit) ){
+			span_count--;
+		}
+		if( (span_count > 0) && (spans[span_count-1].point.x + spans[span_count-1].area.width > x_limit) ){
+			spans[span_count-1].area.width = x_limit - spans[span_count-1].point.x;
+		}
+
+		row = bmap->data + y*bmap->columns;
+		for(row_y = y; row_y < band_end; row_y++){
+			draw_merged_spans(bmap, row, spans, span_count);
+			row += bmap->columns;
+		}
+
+		x = x_limit;
+	} while( x < bmap->area.width );
+
+	return band_end;
+}
+
 void sg_draw_pattern(const sg_bmap_t * bmap, const sg_region_t * region, sg_bmap_data_t odd_pattern, sg_bmap_data_t even_pattern, sg_size_t pattern_height){
 	//fill the specified region with the specified patterns
 	sg_size_t i;
@@ -422,6 +2777,114 @@ void sg_draw_sub_bitmap(
 		const sg_bmap_t * bmap_src,
 		const sg_region_t * region_src
 		){
+	draw_sub_bitmap(bmap_dest, p_dest, bmap_src, region_src, DRAW_ROP_PEN);
+}
+
+/*
+ * Reduces each block of factor x factor source pixels to a coverage value
+ *
+ * Each source word is folded to one bit per pixel (set if the pixel isn't
+ * zero). The bits in each block's part of the word are then counted with a
+ * word-level popcount. A table turns the count for each block into a weight
+ * and the row of weights is blended into the destination.
+ *
+ */
+int sg_draw_downsample(const sg_bmap_t * bmap_dest, sg_point_t p_dest, const sg_bmap_t * bmap_src, u8 factor){
+	const u32 src_bpp = SG_BITS_PER_PIXEL_VALUE(bmap_src);
+	const u32 block_bits = factor * src_bpp;
+	sg_bmap_data_t pixel_lsb;
+	sg_bmap_data_t block_mask;
+	u16 weight[DRAW_DOWNSAMPLE_MAX*DRAW_DOWNSAMPLE_MAX + 1];
+	u16 coverage[DRAW_DOWNSAMPLE_STRIP];
+	u8 count[DRAW_DOWNSAMPLE_STRIP];
+	const sg_bmap_data_t * src;
+	sg_bmap_data_t folded;
+	s32 x_start;
+	s32 x_end;
+	s32 y_start;
+	s32 y_end;
+	s32 strip;
+	s32 width;
+	s32 x;
+	s32 y;
+	u32 bit;
+	u32 shift;
+	u32 i;
+	u32 row;
+
+	if( ((factor != 2) && (factor != 4)) || (src_bpp == 0) || (src_bpp > 8) ){
+		return -1;
+	}
+
+	//set after the checks above (a factor of zero would shift by the word size)
+	//lowest bit of each source pixel
+	pixel_lsb = (sg_bmap_data_t)-1 / (((sg_bmap_data_t)1 << src_bpp) - 1);
+	block_mask = (sg_bmap_data_t)-1 >> (SG_BITS_PER_WORD - block_bits);
+
+	for(i=0; i <= (u32)factor*factor; i++){
+		weight[i] = (i*256 + factor*factor/2) / (factor*factor);
+	}
+
+	//destination pixels that are inside both bitmaps
+	x_start = p_dest.x < 0 ? -p_dest.x : 0;
+	y_start = p_dest.y < 0 ? -p_dest.y : 0;
+	x_end = bmap_src->area.width / factor;
+	y_end = bmap_src->area.height / factor;
+	if( p_dest.x + x_end > bmap_dest->area.width ){ x_end = bmap_dest->area.width - p_dest.x; }
+	if( p_dest.y + y_end > bmap_dest->area.height ){ y_end = bmap_dest->area.height - p_dest.y; }
+
+	for(y = y_start; y < y_end; y++){
+		for(strip = x_start; strip < x_end; strip += DRAW_DOWNSAMPLE_STRIP){
+			width = x_end - strip;
+			if( width > DRAW_DOWNSAMPLE_STRIP ){
+				width = DRAW_DOWNSAMPLE_STRIP;
+			}
+
+			memset(count, 0, width);
+			for(row=0; row < factor; row++){
+				src = bmap_src->data + (y*factor + row)*bmap_src->columns;
+				folded = 0;
+				for(x=0; x < width; x++){
+					bit = (strip + x) * block_bits;
+					shift = bit % SG_BITS_PER_WORD;
+					if( (x == 0) || (shift == 0) ){
+						folded = src[bit / SG_BITS_PER_WORD];
+						for(i=1; i < src_bpp; i <<= 1){
+							folded |= folded >> i;
+						}
+						folded &= pixel_lsb;
+					}
+					count[x] += __builtin_popcount(folded & (block_mask << shift));
+				}
+			}
+
+			for(x=0; x < width; x++){
+				coverage[x] = weight[count[x]];
+			}
+			sg_draw_coverage_row(bmap_dest, p_dest.x + strip, p_dest.y + y, coverage, width);
+		}
+	}
+
+	return 0;
+}
+
+void sg_draw_sub_bitmap_rop(
+		const sg_bmap_t * bmap_dest,
+		sg_point_t p_dest,
+		const sg_bmap_t * bmap_src,
+		const sg_region_t * region_src,
+		u8 rop
+		){
+	draw_sub_bitmap(bmap_dest, p_dest, bmap_src, region_src, rop);
+}
+
+void draw_sub_bitmap(
+		const sg_bmap_t * bmap_dest,
+		sg_point_t p_dest,
+		const sg_bmap_t * bmap_src,
+		const sg_region_t * region_src,
+		int rop
+		){
 	sg_int_t i;
 	sg_point_t p_src;
 	sg_area_t d_src;
@@ -431,6 +2894,9 @@ void sg_draw_sub_bitmap(
 	sg_cursor_t x_src_cursor;
 	sg_int_t h;
 	sg_int_t w;
+	sg_cursor_expand_t expand;
+	int is_expand;
+	sg_pen_rop_t pen_rop;
 
 	p_src = region_src->point;
 	d_src = region_src->area;
@@ -466,13 +2932,26 @@ void sg_draw_sub_bitmap(
 			return;
 		}
 
+		//build the expansion table once rather than on every row
+		is_expand = (rop == DRAW_ROP_PEN) &&
+				(bmap_dest->bits_per_pixel != bmap_src->bits_per_pixel) &&
+				(sg_cursor_expand_init(&expand, bmap_dest, bmap_src) == 0);
+
+		sg_pen_rop_init(&pen_rop, bmap_dest);
+
 		//take bitmap and draw it on bmap
 		for(i=0; i < h; i++){
 			sg_cursor_copy(&x_dest_cursor, &y_dest_cursor);
 			sg_cursor_copy(&x_src_cursor, &y_src_cursor);
 
 			//copy the src cursor to the dest cursor over the source width
-			sg_cursor_draw_cursor(&x_dest_cursor, &x_src_cursor, w);
+			if( rop != DRAW_ROP_PEN ){
+				sg_cursor_draw_cursor_rop(&x_dest_cursor, &x_src_cursor, w, pen_rop.pattern, rop);
+			} else if( is_expand ){
+				sg_cursor_draw_cursor_expand(&x_dest_cursor, &x_src_cursor, w, &expand);
+			} else {
+				sg_cursor_draw_cursor(&x_dest_cursor, &x_src_cursor, w);
+			}
 
 			sg_cursor_inc_y(&y_dest_cursor);
 			sg_cursor_inc_y(&y_src_cursor);
@@ -481,91 +2960,334 @@ void sg_draw_sub_bitmap(
 }
 
 
+/*
+ * The spans and the visited mask are kept in fixed arrays on the stack.
+ * If the bounds have more pixels than the mask holds, the pour runs
+ * without it so spans that don't fit on the stack are dropped.
+ *
+ */
 void sg_draw_pour(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region){
+	sg_pour_span_t spans[DRAW_POUR_SPANS];
+	u32 visited[DRAW_POUR_VISITED_WORDS];
+	pour_stack_t pour;
+	pour.spans = spans;
+	pour.max_spans = DRAW_POUR_SPANS;
+	if( start_pour(&pour, bmap, p, region, visited, DRAW_POUR_VISITED_WORDS) ){
+		finish_pour(&pour);
+	}
+}
 
-	sg_color_t active_color;
-	sg_region_t tmp_region;
+/*
+ * Scanline flood fill with an explicit stack
+ *
+ * Each entry on the stack is a span that has already been filled along
+ * with the direction (dy) of the row that still needs to be checked. When
+ * a span is popped, the neighbouring row is scanned (a word at a time) for
+ * pixels that aren't the active color within the span. Each run that is
+ * found is extended to the left and right, filled and pushed. Parts of the
+ * new run that stick out past the parent span are also pushed in the
+ * opposite direction so the fill can turn corners.
+ *
+ * Pixels are only pushed once they have been set to the active color so
+ * every pixel is filled at most once and the loop always ends.
+ *
+ * Filled pixels are the same color as the outline so the bitmap can't
+ * show where a dropped span was. With a visited mask, filled pixels are
+ * also marked there and when the stack drains after spans were dropped,
+ * the marked runs on the rows that dropped spans are pushed again (see
+ * rescan_pour()). Each rescan fills at least one more pixel so this ends
+ * and only pixels connected to p are ever filled.
+ *
+ */
+int sg_draw_pour_spans(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, sg_pour_span_t * spans, u32 max_spans, u32 * visited){
+	pour_stack_t pour;
+	pour.spans = spans;
+	pour.max_spans = max_spans;
+	if( start_pour(&pour, bmap, p, region, visited, (u32)-1) ){
+		finish_pour(&pour);
+	}
+	return pour.dropped;
+}
 
+//drains the stack and rescans where spans were dropped until none are (or there is no visited mask)
+void finish_pour(pour_stack_t * pour){
+	draw_pour_stack(pour);
+	while( pour->dropped && pour->visited && pour->max_spans ){
+		rescan_pour(pour);
+	}
+}
+
+//sets up the pour and fills the span at p (returns zero if there is nothing to fill)
+int start_pour(pour_stack_t * pour, const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, u32 * visited, u32 visited_words){
+	sg_int_t left;
+	sg_int_t right;
+	s32 limit;
+	u32 words;
+
+	pour->bmap = bmap;
 	if( bmap->pen.o_flags & SG_PEN_FLAG_IS_ERASE ){
-		active_color = 0;
+		pour->active_color = 0;
 	} else {
-		active_color = bmap->pen.color & ((1<<SG_BITS_PER_PIXEL_VALUE(bmap)) - 1);
+		pour->active_color = bmap->pen.color & SG_PIXEL_MASK(bmap);
 	}
+	pour->active_pattern = pour->active_color * ((sg_bmap_data_t)-1 / SG_PIXEL_MASK(bmap));
+	pour->count = 0;
+	pour->dropped = 0;
+	pour->visited = 0;
+	pour->drop_y_min = SG_MAX;
+	pour->drop_y_max = -1;
 
 	//limit bounds to inside the bmap
-	if( (region->point.x + region->area.width < 0) || (region->point.y + region->area.height < 0) ){
-		return;
+	limit = region->point.x;
+	if( limit < 0 ){ limit = 0; }
+	pour->x_min = limit;
+	limit = region->point.x + region->area.width - 1;
+	if( limit >= bmap->area.width ){ limit = bmap->area.width - 1; }
+	pour->x_max = limit;
+
+	limit = region->point.y;
+	if( limit < 0 ){ limit = 0; }
+	pour->y_min = limit;
+	limit = region->point.y + region->area.height - 1;
+	if( limit >= bmap->area.height ){ limit = bmap->area.height - 1; }
+	pour->y_max = limit;
+
+	if( (p.x < pour->x_min) || (p.x > pour->x_max) || (p.y < pour->y_min) || (p.y > pour->y_max) ){
+		return 0;
 	}
 
-	if( (region->point.x >= bmap->area.width) || (region->point.y >= bmap->area.height) ){
-		return;
+	if( sg_get_pixel(bmap, p) == pour->active_color ){
+		return 0;
 	}
 
-	tmp_region = *region;
-
-	if( tmp_region.point.x < 0 ){ tmp_region.point.x = 0; }
-	if( tmp_region.point.y < 0 ){ tmp_region.point.y = 0; }
-	if( tmp_region.point.x + tmp_region.area.width >= bmap->area.width ){ tmp_region.area.width = bmap->area.width - tmp_region.point.x; }
-	if( tmp_region.point.y + tmp_region.area.height >= bmap->area.height ){ tmp_region.area.height = bmap->area.height - tmp_region.point.y; }
+	pour->visited_columns = (pour->x_max - pour->x_min + SG_BITS_PER_WORD) / SG_BITS_PER_WORD;
+	words = pour->visited_columns * (pour->y_max - pour->y_min + 1);
+	if( visited && (words <= visited_words) ){
+		pour->visited = visited;
+		memset(visited, 0, words * sizeof(u32));
+	}
 
-	draw_pour_recursive(bmap, p, &tmp_region, active_color);
+	right = draw_pour_span(pour, p.x, p.y, 1, &left);
+	push_pour_span(pour, p.y, left, right, 1);
+	push_pour_span(pour, p.y, left, right, -1);
+	return 1;
 }
 
-static int is_not_active_color(sg_color_t color, sg_color_t active_color){
-	return color != active_color;
+//checks the rows next to the spans on the stack until it is empty
+void draw_pour_stack(pour_stack_t * pour){
+	sg_pour_span_t span;
+	sg_int_t left;
+	sg_int_t right;
+	sg_int_t x;
+	sg_int_t y;
+
+	while( pour->count ){
+		span = pour->spans[--pour->count];
+		y = span.y + span.dy;
+		if( (y < pour->y_min) || (y > pour->y_max) ){
+			continue;
+		}
+
+		x = span.left;
+		while( x <= span.right ){
+			sg_cursor_t cursor;
+			sg_point_t start;
+			start.x = x;
+			start.y = y;
+			sg_cursor_set(&cursor, pour->bmap, start);
+			x += sg_cursor_find_color(&cursor, span.right - x + 1, pour->active_color, 0);
+			if( x > span.right ){
+				break;
+			}
+
+			//only the first run can reach past the left side of the parent
+			right = draw_pour_span(pour, x, y, x == span.left, &left);
+			push_pour_span(pour, y, left, right, span.dy);
+			if( left < span.left ){
+				push_pour_span(pour, y, left, span.left - 1, -span.dy);
+			}
+			if( right > span.right ){
+				push_pour_span(pour, y, span.right + 1, right, -span.dy);
+			}
+
+			//the pixel after right is the active color (or out of bounds)
+			x = right + 2;
+		}
+	}
 }
 
-int draw_pour_recursive(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, sg_color_t active_color){
+/*
+ * Fills the run of pixels that aren't the active color that includes (x, y)
+ *
+ * The ends of the run are found with the word-at-a-time edge scan. The run
+ * is set to the active color with masked word fills (rather than the pen's
+ * raster operation) so the filled pixels are guaranteed to stop the scan.
+ *
+ * Returns the last pixel in the run and stores the first in left.
+ *
+ */
+sg_int_t draw_pour_span(pour_stack_t * pour, sg_int_t x, sg_int_t y, int is_extend_left, sg_int_t * left){
 	sg_cursor_t cursor;
-	sg_cursor_set(&cursor, bmap, p);
-	if( is_not_active_color(sg_cursor_get_pixel_no_increment(&cursor), active_color) ){
-		sg_point_t draw_point;
-		sg_int_t xmin, xmax;
-		sg_int_t x;
-		sg_int_t x_max_bound = region->point.x + region->area.width;
-		sg_int_t y_max_bound = region->point.y + region->area.height;
-		draw_point = p;
-		xmin = p.x;
-		xmax = p.y;
+	sg_point_t p;
+	sg_int_t right;
+
+	p.x = x;
+	p.y = y;
+	*left = x;
+	if( is_extend_left && (x > pour->x_min) ){
+		p.x = x - 1;
+		sg_cursor_set(&cursor, pour->bmap, p);
+		*left = x - sg_cursor_find_color_reverse(&cursor, x - pour->x_min, pour->active_color, 1);
+		p.x = x;
+	}
 
-		while( is_not_active_color(sg_cursor_get_pixel_no_increment(&cursor), active_color) &&
-				 (draw_point.x < x_max_bound) ){
-			sg_cursor_draw_pixel(&cursor);
-			draw_point.x++;
-		}
+	sg_cursor_set(&cursor, pour->bmap, p);
+	right = x + sg_cursor_find_color(&cursor, pour->x_max - x + 1, pour->active_color, 1) - 1;
 
-		xmax = draw_point.x;
+	fill_pour_run(pour, y, *left, right);
+	return right;
+}
 
-		sg_cursor_set(&cursor, bmap, p);
-		draw_point = p;
-		sg_cursor_dec_x(&cursor);
-		draw_point.x--;
-		while( is_not_active_color(sg_cursor_get_pixel_no_increment(&cursor), active_color) && (draw_point.x > region->point.x) ){
-			sg_cursor_draw_pixel_no_increment(&cursor);
-			sg_cursor_dec_x(&cursor);
-			draw_point.x--;
+//sets left to right on row y to the active color with masked word writes
+void fill_pour_run(const pour_stack_t * pour, sg_int_t y, sg_int_t left, sg_int_t right){
+	const u32 bits_per_pixel = SG_BITS_PER_PIXEL_VALUE(pour->bmap);
+	sg_bmap_data_t * row;
+	sg_point_t p;
+	u32 start_bit;
+	u32 end_bit;
+	u32 first;
+	u32 last;
+	sg_bmap_data_t head_mask;
+	sg_bmap_data_t tail_mask;
+
+	p.x = 0;
+	p.y = y;
+	row = sg_bmap_data(pour->bmap, p);
+	start_bit = left * bits_per_pixel;
+	end_bit = (right + 1) * bits_per_pixel;
+	first = start_bit / SG_BITS_PER_WORD;
+	last = (end_bit - 1) / SG_BITS_PER_WORD;
+	head_mask = (sg_bmap_data_t)-1 << (start_bit % SG_BITS_PER_WORD);
+	tail_mask = (sg_bmap_data_t)-1 >> ((SG_BITS_PER_WORD - end_bit % SG_BITS_PER_WORD) % SG_BITS_PER_WORD);
+
+	if( first == last ){
+		sg_fill_words(row + first, 1, pour->active_pattern, head_mask & tail_mask, SG_ROP_COPY);
+	} else {
+		sg_fill_words(row + first, 1, pour->active_pattern, head_mask, SG_ROP_COPY);
+		sg_fill_words(row + first + 1, last - first - 1, pour->active_pattern, (sg_bmap_data_t)-1, SG_ROP_COPY);
+		sg_fill_words(row + last, 1, pour->active_pattern, tail_mask, SG_ROP_COPY);
+	}
+
+	if( pour->visited ){
+		mark_pour_visited(pour, y, left, right);
+	}
+}
+
+//pushes a filled span (spans that don't fit are counted and dropped)
+void push_pour_span(pour_stack_t * pour, sg_int_t y, sg_int_t left, sg_int_t right, s8 dy){
+	sg_pour_span_t * span;
+	if( pour->count == pour->max_spans ){
+		pour->dropped++;
+		if( y < pour->drop_y_min ){ pour->drop_y_min = y; }
+		if( y > pour->drop_y_max ){ pour->drop_y_max = y; }
+		return;
+	}
+	span = pour->spans + pour->count++;
+	span->y = y;
+	span->left = left;
+	span->right = right;
+	span->dy = dy;
+}
+
+//sets the bits for left to right on row y in the visited mask
+void mark_pour_visited(const pour_stack_t * pour, sg_int_t y, sg_int_t left, sg_int_t right){
+	u32 * row = pour->visited + (y - pour->y_min) * pour->visited_columns;
+	u32 start_bit = left - pour->x_min;
+	u32 end_bit = right - pour->x_min + 1;
+	u32 first = start_bit / SG_BITS_PER_WORD;
+	u32 last = (end_bit - 1) / SG_BITS_PER_WORD;
+	u32 head_mask = (u32)-1 << (start_bit % SG_BITS_PER_WORD);
+	u32 tail_mask = (u32)-1 >> ((SG_BITS_PER_WORD - end_bit % SG_BITS_PER_WORD) % SG_BITS_PER_WORD);
+	u32 i;
+
+	if( first == last ){
+		row[first] |= head_mask & tail_mask;
+		return;
+	}
+	row[first] |= head_mask;
+	for(i = first + 1; i < last; i++){
+		row[i] = (u32)-1;
+	}
+	row[last] |= tail_mask;
+}
+
+//finds the first run of visited pixels on row y at or after x (returns zero if there is none)
+int find_pour_visited(const pour_stack_t * pour, sg_int_t y, sg_int_t x, sg_int_t * left, sg_int_t * right){
+	const u32 * row = pour->visited + (y - pour->y_min) * pour->visited_columns;
+	const u32 end = pour->x_max - pour->x_min + 1;
+	u32 bit = x - pour->x_min;
+
+	//skip clear bits (whole words at a time)
+	while( (bit < end) && ((row[bit / SG_BITS_PER_WORD] & ((u32)1 << (bit % SG_BITS_PER_WORD))) == 0) ){
+		if( (bit % SG_BITS_PER_WORD == 0) && (row[bit / SG_BITS_PER_WORD] == 0) ){
+			bit += SG_BITS_PER_WORD;
+		} else {
+			bit++;
 		}
-		xmin = draw_point.x;
+	}
+	if( bit >= end ){
+		return 0;
+	}
+	*left = pour->x_min + bit;
 
-		for(x = xmin+1; x < xmax; x++){
-			if( p.y+1 < y_max_bound ){
-				draw_point.x = x;
-				draw_point.y = p.y+1;
-				x = draw_pour_recursive(bmap, draw_point, region, active_color);
-			}
+	//skip set bits (whole words at a time)
+	while( (bit < end) && (row[bit / SG_BITS_PER_WORD] & ((u32)1 << (bit % SG_BITS_PER_WORD))) ){
+		if( (bit % SG_BITS_PER_WORD == 0) && (row[bit / SG_BITS_PER_WORD] == (u32)-1) ){
+			bit += SG_BITS_PER_WORD;
+		} else {
+			bit++;
 		}
+	}
+	if( bit > end ){
+		bit = end;
+	}
+	*right = pour->x_min + bit - 1;
+	return 1;
+}
 
-		for(x = xmin+1; x < xmax; x++){
-			if( p.y-1 >= region->point.y ){
-				draw_point.x = x;
-				draw_point.y = p.y-1;
-				x = draw_pour_recursive(bmap, draw_point, region, active_color);
+/*
+ * Checks the rows next to the filled runs of the rows where spans were dropped
+ *
+ * Each visited run on those rows is pushed in both directions on its own
+ * and the stack is drained before the next one, so the pushes always
+ * fit. The rows next to a dropped span can only be reached through the
+ * visited mask, never through pixels that were the active color before
+ * the pour, so the fill can't leak past the outline.
+ *
+ */
+void rescan_pour(pour_stack_t * pour){
+	const sg_int_t y_min = pour->drop_y_min;
+	const sg_int_t y_max = pour->drop_y_max;
+	sg_int_t left;
+	sg_int_t right;
+	sg_int_t x;
+	sg_int_t y;
+	s8 dy;
+
+	pour->dropped = 0;
+	pour->drop_y_min = SG_MAX;
+	pour->drop_y_max = -1;
+
+	for(y = y_min; y <= y_max; y++){
+		x = pour->x_min;
+		while( (x <= pour->x_max) && find_pour_visited(pour, y, x, &left, &right) ){
+			for(dy = -1; dy <= 1; dy += 2){
+				push_pour_span(pour, y, left, right, dy);
+				draw_pour_stack(pour);
 			}
+			x = right + 1;
 		}
-
-		return xmax;
 	}
-	return p.x;
 }
 
 
@@ -585,7 +3307,7 @@ int is_point_visible(const sg_bmap_t * bmap, sg_point_t p){
 //TODO this needs to account for margins
 int truncate_visible(const sg_bmap_t * bmap, sg_point_t * p, sg_area_t * d){
 	if( p->x < 0 ){
-		if( p->x + d->width >= 0 ){
+		if( p->x + d->width > 0 ){
 			d->width += p->x;
 			p->x = 0;
 		} else {
@@ -594,7 +3316,7 @@ int truncate_visible(const sg_bmap_t * bmap, sg_point_t * p, sg_area_t * d){
 	}
 
 	if( p->y < 0 ){
-		if( p->y + bmap->area.height >= 0 ){
+		if( p->y + d->height > 0 ){
 			d->height += p->y;
 			p->y = 0;
 		} else {
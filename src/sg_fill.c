@@ -0,0 +1,153 @@
+//COPYING: Copyright 2011-2020 Tyler Gilbert and Stratify Labs, Inc; see LICENSE.md for rights.
+
+#include "sg_config.h"
+#include "sg.h"
+
+/*
+ * Fills runs of aligned words with a pattern
+ *
+ * The portable kernel is used on all targets. On link (host) builds
+ * for x86 processors, SSE2 and AVX2 kernels are also compiled and the
+ * best one that the processor supports is selected by fill_words_init().
+ * It runs once as a constructor when the program loads, before any thread
+ * can draw, so fill_words_wide is only read after that. Until then (or if
+ * constructors aren't run) it points to the portable kernel.
+ * sg_fill_words_kernel() runs a kernel by name so each one can be tested
+ * no matter which one the processor would select.
+ *
+ * The rop is one of the SG_ROP_ codes and only the bits that are set in
+ * mask are written. Because the pattern is the same for every word, any
+ * raster operation reduces to (word & and_mask) ^ xor_mask so the kernels
+ * only need one loop (plus a store loop for operations that don't depend
+ * on the destination).
+ *
+ */
+
+#if defined __link && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define SG_FILL_SIMD 1
+#include <immintrin.h>
+#else
+#define SG_FILL_SIMD 0
+#endif
+
+//runs shorter than this are not worth the setup of a vector kernel
+#define SG_FILL_SIMD_MIN_WORDS 8
+
+typedef void (*fill_words_t)(sg_bmap_data_t * target, u32 count, sg_bmap_data_t and_mask, sg_bmap_data_t xor_mask);
+
+static void fill_words(sg_bmap_data_t * target, u32 count, sg_bmap_data_t and_mask, sg_bmap_data_t xor_mask);
+static void calc_fill_masks(sg_bmap_data_t pattern, sg_bmap_data_t mask, u8 rop, sg_bmap_data_t * and_mask, sg_bmap_data_t * xor_mask);
+
+#if SG_FILL_SIMD
+static void fill_words_init() __attribute__((constructor));
+static void fill_words_sse2(sg_bmap_data_t * target, u32 count, sg_bmap_data_t and_mask, sg_bmap_data_t xor_mask);
+static void fill_words_avx2(sg_bmap_data_t * target, u32 count, sg_bmap_data_t and_mask, sg_bmap_data_t xor_mask);
+
+static fill_words_t fill_words_wide = fill_words;
+#else
+static const fill_words_t fill_words_wide = fill_words;
+#endif
+
+void sg_fill_words(sg_bmap_data_t * target, u32 count, sg_bmap_data_t pattern, sg_bmap_data_t mask, u8 rop){
+	sg_bmap_data_t and_mask;
+	sg_bmap_data_t xor_mask;
+	calc_fill_masks(pattern, mask, rop, &and_mask, &xor_mask);
+	if( count < SG_FILL_SIMD_MIN_WORDS ){
+		fill_words(target, count, and_mask, xor_mask);
+	} else {
+		fill_words_wide(target, count, and_mask, xor_mask);
+	}
+}
+
+int sg_fill_words_kernel(u32 kernel, sg_bmap_data_t * target, u32 count, sg_bmap_data_t pattern, sg_bmap_data_t mask, u8 rop){
+	sg_bmap_data_t and_mask;
+	sg_bmap_data_t xor_mask;
+	fill_words_t fill = fill_words;
+
+#if SG_FILL_SIMD
+	__builtin_cpu_init();
+	if( kernel == SG_FILL_KERNEL_SSE2 ){
+		if( __builtin_cpu_supports("sse2") == 0 ){ return -1; }
+		fill = fill_words_sse2;
+	} else if( kernel == SG_FILL_KERNEL_AVX2 ){
+		if( __builtin_cpu_supports("avx2") == 0 ){ return -1; }
+		fill = fill_words_avx2;
+	} else if( kernel != SG_FILL_KERNEL_PORTABLE ){
+		return -1;
+	}
+#else
+	if( kernel != SG_FILL_KERNEL_PORTABLE ){
+		return -1;
+	}
+#endif
+
+	calc_fill_masks(pattern, mask, rop, &and_mask, &xor_mask);
+	fill(target, count, and_mask, xor_mask);
+	return 0;
+}
+
+void calc_fill_masks(sg_bmap_data_t pattern, sg_bmap_data_t mask, u8 rop, sg_bmap_data_t * and_mask, sg_bmap_data_t * xor_mask){
+	//results where the destination bit is zero and where it is one (bits outside mask are unchanged)
+	sg_bmap_data_t zero = sg_calc_rop(rop, pattern, 0) & mask;
+	sg_bmap_data_t one = sg_calc_rop(rop, pattern, (sg_bmap_data_t)-1) | ~mask;
+	*and_mask = zero ^ one;
+	*xor_mask = zero;
+}
+
+void fill_words(sg_bmap_data_t * target, u32 count, sg_bmap_data_t and_mask, sg_bmap_data_t xor_mask){
+	u32 i;
+	if( and_mask == 0 ){
+		for(i=0; i < count; i++){ target[i] = xor_mask; }
+	} else {
+		for(i=0; i < count; i++){ target[i] = (target[i] & and_mask) ^ xor_mask; }
+	}
+}
+
+#if SG_FILL_SIMD
+
+void fill_words_init(){
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports("avx2") ){
+		fill_words_wide = fill_words_avx2;
+	} else if( __builtin_cpu_supports("sse2") ){
+		fill_words_wide = fill_words_sse2;
+	}
+}
+
+__attribute__((target("sse2")))
+void fill_words_sse2(sg_bmap_data_t * target, u32 count, sg_bmap_data_t and_mask, sg_bmap_data_t xor_mask){
+	const __m128i a = _mm_set1_epi32((int)and_mask);
+	const __m128i x = _mm_set1_epi32((int)xor_mask);
+	__m128i * v = (__m128i*)target;
+	u32 vectors = count / 4;
+	u32 i;
+
+	if( and_mask == 0 ){
+		for(i=0; i < vectors; i++){ _mm_storeu_si128(v + i, x); }
+	} else {
+		for(i=0; i < vectors; i++){ _mm_storeu_si128(v + i, _mm_xor_si128(x, _mm_and_si128(a, _mm_loadu_si128(v + i)))); }
+	}
+
+	fill_words(target + vectors*4, count - vectors*4, and_mask, xor_mask);
+}
+
+__attribute__((target("avx2")))
+void fill_words_avx2(sg_bmap_data_t * target, u32 count, sg_bmap_data_t and_mask, sg_bmap_data_t xor_mask){
+	const __m256i a = _mm256_set1_epi32((int)and_mask);
+	const __m256i x = _mm256_set1_epi32((int)xor_mask);
+	__m256i * v = (__m256i*)target;
+	u32 vectors = count / 8;
+	u32 i;
+
+	if( and_mask == 0 ){
+		for(i=0; i < vectors; i++){ _mm256_storeu_si256(v + i, x); }
+	} else {
+		for(i=0; i < vectors; i++){ _mm256_storeu_si256(v + i, _mm256_xor_si256(x, _mm256_and_si256(a, _mm256_loadu_si256(v + i)))); }
+	}
+
+	//avoid AVX/SSE transition stalls in the caller
+	_mm256_zeroupper();
+	fill_words(target + vectors*8, count - vectors*8, and_mask, xor_mask);
+}
+
+#endif
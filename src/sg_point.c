@@ -691,4 +691,23 @@ void sg_point_bound_y(const sg_bmap_t * bmap, sg_int_t * y){
 	*y = t;
 }
 
+u32 sg_calc_sqrt(u64 value){
+	u64 result = 0;
+	u64 bit = (u64)1 << 62;
 
+	//one result bit per iteration starting with the highest power of four
+	while( bit > value ){
+		bit >>= 2;
+	}
+
+	while( bit ){
+		if( value >= result + bit ){
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+	return result;
+}
@@ -2,35 +2,114 @@
 
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "sg_config.h"
 #include "sg.h"
 
 
-static void draw_line_with_map(sg_point_t p1, sg_point_t p2, sg_bmap_t * bmap, const sg_vector_map_t * map, sg_region_t * region);
-static void draw_quadtratic_bezier_with_map(sg_point_t p1, sg_point_t p2, sg_point_t p3, sg_bmap_t * bmap, const sg_vector_map_t * map, sg_region_t * region);
-static void draw_cubic_bezier_with_map(sg_point_t p1, sg_point_t p2, sg_point_t p3, sg_point_t p4, sg_bmap_t * bmap, const sg_vector_map_t * map, sg_region_t * region);
+//edges that a filled path can hold for one band of rows
+#define VECTOR_FILL_EDGES 48
+
+/*
+ * An edge of a filled path that is stepped down one row at a time
+ *
+ * Rows are sampled at their centers (the mapped points). x is the first
+ * pixel at or to the right of where the edge crosses the row and the
+ * crossing itself is at x - remainder/dy.
+ *
+ */
+typedef struct {
+	s32 x;
+	s32 remainder;
+	s32 step_x /*! Whole pixels per row (rounded down) */;
+	s32 step_remainder /*! Remaining fraction of a pixel per row (in units of 1/dy) */;
+	s32 dy;
+	sg_int_t y_top /*! First row */;
+	sg_int_t y_end /*! Row after the last one */;
+	s8 winding /*! 1 if the edge goes down and -1 if it goes up */;
+} fill_edge_t;
+
+/*
+ * An edge of an antialiased fill
+ *
+ * The end points are in fixed point (VECTOR_COVERAGE_BITS) with pixel
+ * (x, y) covering x to x+1 and y to y+1 so the mapped points (the pixel
+ * centers) are offset by one half.
+ *
+ */
+typedef struct {
+	s32 x0;
+	s32 y0;
+	s32 x1;
+	s32 y1 /*! Always below y0 */;
+	sg_int_t y_top /*! First row */;
+	sg_int_t y_end /*! Row after the last one */;
+	s8 winding /*! 1 if the edge goes down and -1 if it goes up */;
+} coverage_edge_t;
+
+//fraction bits of coverage_edge_t (full coverage of a pixel is 1 << 2*VECTOR_COVERAGE_BITS)
+#define VECTOR_COVERAGE_BITS 8
+#define VECTOR_COVERAGE_ONE (1<<VECTOR_COVERAGE_BITS)
+//pixels in the accumulation row (wider paths are done in strips of this width)
+#define VECTOR_COVERAGE_WIDTH 64
+
+//edges of a filled path that cross a band of rows
+typedef struct {
+	union {
+		fill_edge_t edges[VECTOR_FILL_EDGES];
+		coverage_edge_t lines[VECTOR_FILL_EDGES] /*! Edges when is_antialiased is set */;
+	};
+	u8 is_antialiased;
+	u32 count;
+	u32 dropped /*! Edges that didn't fit */;
+	sg_int_t band_top;
+	sg_int_t band_end;
+	s32 y_min /*! First row of the whole path */;
+	s32 y_max /*! Row after the last row of the whole path */;
+	s32 x_min /*! First column touched by the edges in the band */;
+	s32 x_max /*! Last column touched by the edges in the band */;
+	s32 * cells /*! If not null, edges are added to these cells instead of the table (one row at a time) */;
+	s32 window_x /*! First column of cells */;
+	s32 window_width /*! Number of cells */;
+} fill_band_t;
+
+//height of the strips used by sg_vector_draw_scene()
+#define VECTOR_STRIP_ROWS 32
 
 static void update_bounds(sg_point_t min, sg_point_t max, sg_region_t * region);
-
-static void draw_path_none(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
-static void draw_path_move(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
-static void draw_path_line(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
-static void draw_path_quadtratic_bezier(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
-static void draw_path_cubic_bezier(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
-static void draw_path_close(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
-static void draw_path_pour(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
-
-
-
-static void (*draw_path_func [SG_VECTOR_PATH_TOTAL])(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description) = {
+static int is_path_drawn_in_strips(const sg_vector_path_t * path);
+static void calc_scene_bounds(const sg_bmap_t * bmap, const sg_vector_scene_item_t * item, sg_region_t * bounds);
+static void draw_scene_item(sg_bmap_t * bmap, const sg_vector_scene_item_t * item, sg_point_t origin);
+
+static u32 draw_path_none(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
+static u32 draw_path_move(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
+static u32 draw_path_stroke(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
+static u32 draw_path_pour(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
+static u32 draw_path_fill(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description);
+static void add_fill_edges(fill_band_t * band, const sg_vector_path_description_t * description, const sg_vector_path_description_t * end, const sg_vector_map_t * map);
+static void add_fill_edge(fill_band_t * band, sg_point_t p0, sg_point_t p1);
+static void draw_fill_band(const sg_bmap_t * bmap, fill_band_t * band, int is_odd_even);
+static void draw_coverage_band(const sg_bmap_t * bmap, fill_band_t * band, int is_odd_even);
+static void draw_fill_row(const sg_bmap_t * bmap, fill_band_t * band, const sg_vector_path_description_t * description, const sg_vector_path_description_t * end, const sg_vector_map_t * map, int is_odd_even);
+static void draw_winding_cells(const sg_bmap_t * bmap, const s32 * cells, s32 width, s32 x, s32 y, int is_odd_even);
+static void add_coverage_row(s32 * cells, s32 width, const coverage_edge_t * line, s32 y, s32 strip);
+static void draw_coverage_cells(const sg_bmap_t * bmap, const s32 * cells, s32 width, s32 strip, s32 y, int is_odd_even);
+static void add_coverage_line(s32 * cells, s32 width, s32 x0, s32 y0, s32 x1, s32 y1);
+static void add_coverage_cell(s32 * cells, s32 width, s32 x0, s32 x1, s32 dy);
+
+
+
+//each function returns the number of path descriptions that it used
+static u32 (*draw_path_func [SG_VECTOR_PATH_TOTAL])(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description) = {
 		draw_path_none,
 		draw_path_move,
-		draw_path_line,
-		draw_path_quadtratic_bezier,
-		draw_path_cubic_bezier,
-		draw_path_close,
-		draw_path_pour
+		draw_path_stroke,
+		draw_path_stroke,
+		draw_path_stroke,
+		draw_path_stroke,
+		draw_path_pour,
+		draw_path_fill
 };
 
 
@@ -41,14 +120,161 @@ void sg_vector_draw_path(
 		){
 	u32 i;
 	u32 type;
-	for(i=0; i < path->icon.count; i++){
+	i = 0;
+	while( i < path->icon.count ){
 		type = path->icon.list[i].type;
 		if( type < SG_VECTOR_PATH_TOTAL ){
-			draw_path_func[type](bmap, path, map, path->icon.list + i);
+			i += draw_path_func[type](bmap, path, map, path->icon.list + i);
+		} else {
+			i++;
+		}
+	}
+}
+
+/*
+ * Draws the items one strip at a time
+ *
+ * A strip is VECTOR_STRIP_ROWS rows across the whole bitmap. It is drawn
+ * through a bitmap that shares the memory of bmap but starts at the strip's
+ * top and is only as tall as the strip. The drawing functions already
+ * clip to the bitmap so an item's pixels in a strip are the same as if
+ * it were drawn on the whole bitmap. Maps are moved by the strip's top (a
+ * whole number of pixels) so the mapped points don't change.
+ *
+ * An item is flattened once for each strip that its bounds touch. The
+ * fill's band table is the bin for that strip: it only keeps the edges
+ * that cross the strip and the rows are then filled from it. Strokes are
+ * clipped to the strip as they are drawn. Splitting strips into tiles
+ * would flatten the item again for each one so that isn't done. Keeping
+ * the flattened edges of every item until all strips are drawn would need
+ * memory that grows with the scene.
+ *
+ * Items are binned by testing their bounds against each strip. There
+ * aren't many items in a scene so this avoids storing a list of strips per
+ * item.
+ *
+ */
+void sg_vector_draw_scene(sg_bmap_t * bmap, const sg_vector_scene_item_t * items, u32 count){
+	sg_bmap_t strip;
+	sg_region_t bounds;
+	sg_point_t origin;
+	sg_point_t start;
+	sg_point_t current;
+	u32 i;
+
+	for(i=0; i < count; i++){
+		if( is_path_drawn_in_strips(items[i].path) == 0 ){
+			origin.point = 0;
+			for(i=0; i < count; i++){
+				draw_scene_item(bmap, items + i, origin);
+			}
+			return;
+		}
+	}
+
+	strip = *bmap;
+	origin.x = 0;
+	for(origin.y = 0; origin.y < bmap->area.height; origin.y += VECTOR_STRIP_ROWS){
+		strip.data = sg_bmap_data(bmap, origin);
+		strip.area.height = bmap->area.height - origin.y;
+		if( strip.area.height > VECTOR_STRIP_ROWS ){ strip.area.height = VECTOR_STRIP_ROWS; }
+
+		for(i=0; i < count; i++){
+			calc_scene_bounds(bmap, items + i, &bounds);
+			if( (bounds.point.x >= bmap->area.width) ||
+					(bounds.point.y >= origin.y + strip.area.height) ||
+					(bounds.point.x + bounds.area.width <= 0) ||
+					(bounds.point.y + bounds.area.height <= origin.y) ){
+				continue;
+			}
+
+			//each strip starts the path from the same place
+			start = items[i].path->start;
+			current = items[i].path->current;
+			draw_scene_item(&strip, items + i, origin);
+			items[i].path->start = start;
+			items[i].path->current = current;
+		}
+	}
+
+	//where the paths end up after being drawn in full
+	for(i=0; i < count; i++){
+		sg_vector_path_t * path = items[i].path;
+		const sg_vector_path_description_t * description;
+		for(description = path->icon.list; description < path->icon.list + path->icon.count; description++){
+			if( description->type == SG_VECTOR_PATH_MOVE ){
+				path->start = description->move.point;
+				path->current = description->move.point;
+			} else if( description->type == SG_VECTOR_PATH_LINE ){
+				path->current = description->line.point;
+			} else if( description->type == SG_VECTOR_PATH_QUADRATIC_BEZIER ){
+				path->current = description->quadratic_bezier.point;
+			} else if( description->type == SG_VECTOR_PATH_CUBIC_BEZIER ){
+				path->current = description->cubic_bezier.point;
+			} else if( description->type == SG_VECTOR_PATH_CLOSE ){
+				path->current = path->start;
+			}
 		}
 	}
 }
 
+//a pour needs to read the whole bitmap so it can't be drawn in strips
+int is_path_drawn_in_strips(const sg_vector_path_t * path){
+	u32 i;
+	for(i=0; i < path->icon.count; i++){
+		if( path->icon.list[i].type == SG_VECTOR_PATH_POUR ){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Bounds of every pixel an item can draw
+ *
+ * Points are mapped from a square centered on the map region and rotated
+ * about its center, so a rotated map can reach a circle around the square.
+ * Strokes add the pen thickness.
+ *
+ */
+void calc_scene_bounds(const sg_bmap_t * bmap, const sg_vector_scene_item_t * item, sg_region_t * bounds){
+	const sg_region_t * region = &item->map->region;
+	s32 margin = 2 + (item->pen ? item->pen->thickness : bmap->pen.thickness);
+	s32 x_margin = margin;
+	s32 y_margin = margin;
+
+	if( item->map->rotation % SG_TRIG_POINTS ){
+		//half of the diagonal is less than half of the width plus half of the height
+		x_margin += region->area.height/2;
+		y_margin += region->area.width/2;
+	}
+
+	bounds->point.x = region->point.x - x_margin;
+	bounds->point.y = region->point.y - y_margin;
+	bounds->area.width = region->area.width + 2*x_margin;
+	bounds->area.height = region->area.height + 2*y_margin;
+}
+
+//draws an item on a bitmap whose top left corner is at origin (the item's pen is only used for the item)
+void draw_scene_item(sg_bmap_t * bmap, const sg_vector_scene_item_t * item, sg_point_t origin){
+	sg_vector_path_t * path = item->path;
+	sg_vector_map_t map = *item->map;
+	const sg_pen_t pen = bmap->pen;
+
+	if( item->pen ){
+		bmap->pen = *item->pen;
+	}
+
+	map.region.point.x -= origin.x;
+	map.region.point.y -= origin.y;
+	path->region.point.x -= origin.x;
+	path->region.point.y -= origin.y;
+	sg_vector_draw_path(bmap, path, &map);
+	path->region.point.x += origin.x;
+	path->region.point.y += origin.y;
+	bmap->pen = pen;
+}
+
 void update_bounds(sg_point_t min, sg_point_t max, sg_region_t * region){
 	if( min.x < region->point.x ){
 		if( region->area.width ){
@@ -74,128 +300,708 @@ void update_bounds(sg_point_t min, sg_point_t max, sg_region_t * region){
 	}
 }
 
-void draw_path_none(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
-
+u32 draw_path_none(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
+	return 1;
 }
 
-void draw_path_move(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
+u32 draw_path_move(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
 	path->start = description->move.point;
 	path->current = description->move.point;
+	return 1;
 }
 
-void draw_path_line(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
-	draw_line_with_map(
-				path->current,
-				description->line.point,
-				bmap,
-				map,
-				&path->region
-				);
-
-	path->current = description->line.point;
-}
+/*
+ * Draws consecutive lines, curves and a close that follows them as one
+ * polyline so the joints are only drawn once and a dashed pen carries
+ * its pattern along the whole stroke.
+ *
+ */
+u32 draw_path_stroke(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
+	const sg_vector_path_description_t * end = path->icon.list + path->icon.count;
+	sg_polyline_t polyline;
+	sg_point_t points[4];
+	sg_point_t corners[2];
+	u32 count = 0;
+	u32 type;
+	int i;
 
-void draw_path_quadtratic_bezier(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
-	draw_quadtratic_bezier_with_map(path->current,
-			description->quadratic_bezier.control,
-			description->quadratic_bezier.point,
-			bmap, map, &path->region);
-	path->current = description->quadratic_bezier.point;
-}
+	points[0] = path->current;
+	sg_point_map(points, map);
+	corners[0] = points[0];
+	corners[1] = points[0];
+	sg_polyline_start(&polyline, bmap);
+	sg_polyline_add(&polyline, points[0]);
+
+	while( description + count < end ){
+		type = description[count].type;
+		if( type == SG_VECTOR_PATH_LINE ){
+			points[1] = description[count].line.point;
+			path->current = points[1];
+		} else if( type == SG_VECTOR_PATH_CLOSE ){
+			points[1] = path->start;
+			path->current = points[1];
+		} else if( type == SG_VECTOR_PATH_QUADRATIC_BEZIER ){
+			points[1] = description[count].quadratic_bezier.control;
+			points[2] = description[count].quadratic_bezier.point;
+			path->current = points[2];
+		} else if( type == SG_VECTOR_PATH_CUBIC_BEZIER ){
+			points[1] = description[count].cubic_bezier.control[0];
+			points[2] = description[count].cubic_bezier.control[1];
+			points[3] = description[count].cubic_bezier.point;
+			path->current = points[3];
+		} else {
+			break;
+		}
+		count++;
+
+		//points[0] is already mapped (it is where the last part ended)
+		if( (type == SG_VECTOR_PATH_LINE) || (type == SG_VECTOR_PATH_CLOSE) ){
+			sg_point_map(points + 1, map);
+			if( points[1].x < corners[0].x ){ corners[0].x = points[1].x; }
+			if( points[1].y < corners[0].y ){ corners[0].y = points[1].y; }
+			if( points[1].x > corners[1].x ){ corners[1].x = points[1].x; }
+			if( points[1].y > corners[1].y ){ corners[1].y = points[1].y; }
+			sg_polyline_add(&polyline, points[1]);
+			points[0] = points[1];
+		} else {
+			const int is_cubic = (type == SG_VECTOR_PATH_CUBIC_BEZIER);
+			for(i=1; i <= 2 + is_cubic; i++){
+				sg_point_map(points + i, map);
+			}
+			if( is_cubic == 0 ){
+				points[3] = points[2];
+			}
+			sg_polyline_add_bezier(&polyline, points, is_cubic, corners);
+			points[0] = points[2 + is_cubic];
+		}
 
-void draw_path_cubic_bezier(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
-	draw_cubic_bezier_with_map(path->current,
-			description->cubic_bezier.control[0],
-			description->cubic_bezier.control[1],
-			description->cubic_bezier.point,
-			bmap, map, &path->region);
-	path->current = description->quadratic_bezier.point;
-}
+		if( type == SG_VECTOR_PATH_CLOSE ){
+			break;
+		}
+	}
 
-void draw_path_close(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
-	draw_line_with_map(path->current,
-			path->start,
-			bmap, map, &path->region);
-	path->current = path->start;
+	sg_polyline_finish(&polyline);
+	update_bounds(corners[0], corners[1], &path->region);
+	return count;
 }
 
-void draw_path_pour(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
+u32 draw_path_pour(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
 	sg_point_t point = description->pour.point;
 	sg_point_map(&point, map);
 	sg_draw_pour(bmap, point, &(path->region));
+	return 1;
 }
 
+/*
+ * Fills the outlines between the last fill and this one
+ *
+ * The outlines are flattened to edges and each row is filled with an
+ * active edge table: the edges that cross the row are sorted by where
+ * they cross and the winding rule picks the spans between them.
+ *
+ * Only edges that cross the band of rows being drawn are kept. If there
+ * are too many for the table, the band is split in half and the outlines
+ * are walked again for each part.
+ *
+ */
+u32 draw_path_fill(sg_bmap_t * bmap, sg_vector_path_t * path, const sg_vector_map_t * map, const sg_vector_path_description_t * description){
+	const sg_vector_path_description_t * first = description;
+	const int is_odd_even = (description->fill.o_flags & SG_VECTOR_PATH_FLAG_IS_FILL_ODD_EVEN) != 0;
+	fill_band_t band;
+	s32 band_height = bmap->area.height;
+
+	band.is_antialiased = sg_pen_is_antialiased(bmap);
+	band.cells = 0;
+
+	while( (first > path->icon.list) && (first[-1].type != SG_VECTOR_PATH_FILL) ){
+		first--;
+	}
 
-void draw_line_with_map(sg_point_t p1,
-		sg_point_t p2,
-		sg_bmap_t * bmap,
-		const sg_vector_map_t * map,
-		sg_region_t * region){
-	//apply bitmap space rotation
-	sg_point_map(&p1, map);
-	sg_point_map(&p2, map);
+	band.band_top = 0;
+	while( band.band_top < bmap->area.height ){
+		band.band_end = band.band_top + band_height;
+		if( band.band_end > bmap->area.height ){
+			band.band_end = bmap->area.height;
+		}
+		band.count = 0;
+		band.dropped = 0;
+		band.y_min = bmap->area.height;
+		band.y_max = 0;
+		band.x_min = bmap->area.width;
+		band.x_max = -1;
+		add_fill_edges(&band, first, description, map);
+
+		if( band.dropped && (band_height > 1) ){
+			//the rows above the path don't need to be walked again
+			if( band.y_min > band.band_top ){
+				band.band_top = band.y_min;
+			}
+			band_height = (band_height + 1) / 2;
+			continue;
+		}
+
+		if( band.dropped ){
+			//one row crosses more edges than the table holds
+			draw_fill_row(bmap, &band, first, description, map, is_odd_even);
+		} else {
+			if( band.is_antialiased ){
+				draw_coverage_band(bmap, &band, is_odd_even);
+			} else {
+				draw_fill_band(bmap, &band, is_odd_even);
+			}
+
+			//grow the bands again after the rows that needed fewer
+			if( band_height < bmap->area.height ){
+				band_height *= 2;
+			}
+		}
 
-	if( region ){
-		sg_point_t min, max;
+		if( band.band_end >= band.y_max ){
+			break;
+		}
+		band.band_top = band.band_end;
+	}
 
-		min = p1;
-		max = p1;
-		if( p2.x < min.x ){ min.x = p2.x; }
-		if( p2.y < min.y ){ min.y = p2.y; }
+	return 1;
+}
 
-		if( p2.x > max.x ){ max.x = p2.x; }
-		if( p2.y > max.y ){ max.y = p2.y; }
+//adds the edges of each outline (closing the ones that are still open)
+void add_fill_edges(fill_band_t * band, const sg_vector_path_description_t * description, const sg_vector_path_description_t * end, const sg_vector_map_t * map){
+	sg_bezier_t bezier;
+	sg_point_t start;
+	sg_point_t current;
+	sg_point_t points[4];
+	int is_open = 0;
+	int is_cubic;
+	int i;
 
-		update_bounds(min, max, region);
+	start.point = 0;
+	current.point = 0;
+	for(; description < end; description++){
+		switch( description->type ){
+		case SG_VECTOR_PATH_MOVE:
+			if( is_open ){
+				add_fill_edge(band, current, start);
+			}
+			start = description->move.point;
+			sg_point_map(&start, map);
+			current = start;
+			is_open = 1;
+			break;
+
+		case SG_VECTOR_PATH_LINE:
+			points[1] = description->line.point;
+			sg_point_map(points + 1, map);
+			if( is_open ){
+				add_fill_edge(band, current, points[1]);
+			}
+			current = points[1];
+			break;
+
+		case SG_VECTOR_PATH_QUADRATIC_BEZIER:
+		case SG_VECTOR_PATH_CUBIC_BEZIER:
+			is_cubic = (description->type == SG_VECTOR_PATH_CUBIC_BEZIER);
+			points[0] = current;
+			if( is_cubic ){
+				points[1] = description->cubic_bezier.control[0];
+				points[2] = description->cubic_bezier.control[1];
+				points[3] = description->cubic_bezier.point;
+			} else {
+				points[1] = description->quadratic_bezier.control;
+				points[2] = description->quadratic_bezier.point;
+			}
+			for(i=1; i <= 2 + is_cubic; i++){
+				sg_point_map(points + i, map);
+			}
+			if( is_open ){
+				sg_bezier_start(&bezier, points, is_cubic);
+				while( sg_bezier_next(&bezier, points + 0) ){
+					add_fill_edge(band, current, points[0]);
+					current = points[0];
+				}
+			}
+			current = points[2 + is_cubic];
+			break;
+
+		case SG_VECTOR_PATH_CLOSE:
+			if( is_open ){
+				add_fill_edge(band, current, start);
+			}
+			current = start;
+			break;
+		}
 	}
 
-	//add the option to invert the line
-	sg_draw_line(bmap, p1, p2);
+	if( is_open ){
+		add_fill_edge(band, current, start);
+	}
 }
-void draw_quadtratic_bezier_with_map(sg_point_t p1, sg_point_t p2, sg_point_t p3, sg_bmap_t * bmap, const sg_vector_map_t * map, sg_region_t * region){
-	int i;
-	sg_point_t points[3];
-	sg_point_t corners[2];
 
-	//maps the points to the bmap
-	points[0] = p1;
-	points[1] = p2;
-	points[2] = p3;
+void add_fill_edge(fill_band_t * band, sg_point_t p0, sg_point_t p1){
+	fill_edge_t * edge;
+	coverage_edge_t * line;
+	fill_edge_t row_edge;
+	coverage_edge_t row_line;
+	s32 column;
+	s32 y_end;
+	sg_point_t tmp;
+	s8 winding = 1;
+	s32 dx;
+	s64 numerator;
+	s64 x;
+
+	if( p0.y == p1.y ){
+		//horizontal edges don't cross any row centers
+		return;
+	}
+
+	if( p0.y > p1.y ){
+		tmp = p0;
+		p0 = p1;
+		p1 = tmp;
+		winding = -1;
+	}
+
+	//an antialiased edge also covers part of the row at its bottom point
+	y_end = p1.y + band->is_antialiased;
+
+	if( p0.y < band->y_min ){
+		band->y_min = p0.y;
+	}
+	if( y_end > band->y_max ){
+		band->y_max = y_end;
+	}
+
+	if( (y_end <= band->band_top) || (p0.y >= band->band_end) ){
+		return;
+	}
 
-	for(i=0; i < 3; i++){
-		sg_point_map(points + i, map);
+	if( (band->cells == 0) && (band->count == VECTOR_FILL_EDGES) ){
+		band->dropped++;
+		return;
 	}
 
-	sg_draw_quadratic_bezier(bmap, points[0], points[1], points[2], corners);
-	if( region ){
-		update_bounds(corners[0], corners[1], region);
+	if( band->is_antialiased ){
+		line = band->cells ? &row_line : band->lines + band->count++;
+		line->winding = winding;
+		line->y_top = p0.y < band->band_top ? band->band_top : p0.y;
+		line->y_end = y_end > band->band_end ? band->band_end : y_end;
+		line->x0 = p0.x*VECTOR_COVERAGE_ONE + VECTOR_COVERAGE_ONE/2;
+		line->y0 = p0.y*VECTOR_COVERAGE_ONE + VECTOR_COVERAGE_ONE/2;
+		line->x1 = p1.x*VECTOR_COVERAGE_ONE + VECTOR_COVERAGE_ONE/2;
+		line->y1 = p1.y*VECTOR_COVERAGE_ONE + VECTOR_COVERAGE_ONE/2;
+		if( p0.x < band->x_min ){ band->x_min = p0.x; }
+		if( p1.x < band->x_min ){ band->x_min = p1.x; }
+		if( p0.x > band->x_max ){ band->x_max = p0.x; }
+		if( p1.x > band->x_max ){ band->x_max = p1.x; }
+		if( band->cells ){
+			add_coverage_row(band->cells, band->window_width, line, band->band_top, band->window_x);
+		}
+		return;
+	}
+
+	edge = band->cells ? &row_edge : band->edges + band->count++;
+	edge->winding = winding;
+	edge->y_top = p0.y < band->band_top ? band->band_top : p0.y;
+	edge->y_end = p1.y > band->band_end ? band->band_end : p1.y;
+	edge->dy = p1.y - p0.y;
+	dx = p1.x - p0.x;
+
+	//floor(dx/dy) and the remainder
+	edge->step_x = dx / edge->dy;
+	if( edge->step_x * edge->dy > dx ){
+		edge->step_x--;
+	}
+	edge->step_remainder = dx - edge->step_x * edge->dy;
+
+	//ceil(numerator/dy) where the crossing at y_top is numerator/dy
+	numerator = (s64)p0.x * edge->dy + (s64)(edge->y_top - p0.y) * dx;
+	x = numerator / edge->dy;
+	if( x * edge->dy < numerator ){
+		x++;
+	}
+	edge->x = x;
+	edge->remainder = x * edge->dy - numerator;
+
+	if( band->cells ){
+		//the edge changes the winding of its pixel and every pixel after it
+		column = edge->x - band->window_x;
+		if( column < 0 ){
+			column = 0;
+		}
+		if( column < band->window_width ){
+			band->cells[column] += edge->winding;
+		}
 	}
 }
 
-void draw_cubic_bezier_with_map(sg_point_t p1, sg_point_t p2, sg_point_t p3, sg_point_t p4, sg_bmap_t * bmap, const sg_vector_map_t * map, sg_region_t * region){
-	int i;
-	sg_point_t points[4];
-	sg_point_t corners[2];
+/*
+ * Fills the rows of the band
+ *
+ * Edges are added to the active table when the scan reaches their top
+ * row and dropped after their last row. The active edges are kept
+ * sorted by x (the order only changes where edges cross so insertion sort
+ * is close to linear).
+ *
+ */
+void draw_fill_band(const sg_bmap_t * bmap, fill_band_t * band, int is_odd_even){
+	fill_edge_t * edges = band->edges;
+	fill_edge_t tmp;
+	fill_edge_t * edge;
+	u8 active[VECTOR_FILL_EDGES];
+	sg_region_t spans[VECTOR_FILL_EDGES/2];
+	u32 active_count = 0;
+	u32 span_count;
+	u32 next = 0;
+	u32 i;
+	u32 j;
+	u8 index;
+	s32 winding;
+	s32 left = 0;
+	s32 right;
+	s32 y;
+
+	if( band->count == 0 ){
+		return;
+	}
+
+	//sort by the top row
+	for(i=1; i < band->count; i++){
+		for(j=i; (j > 0) && (edges[j].y_top < edges[j-1].y_top); j--){
+			tmp = edges[j];
+			edges[j] = edges[j-1];
+			edges[j-1] = tmp;
+		}
+	}
+
+	for(y = edges[0].y_top; (next < band->count) || active_count; y++){
+		//drop edges that have ended
+		j = 0;
+		for(i=0; i < active_count; i++){
+			if( edges[active[i]].y_end > y ){
+				active[j++] = active[i];
+			}
+		}
+		active_count = j;
+
+		while( (next < band->count) && (edges[next].y_top == y) ){
+			active[active_count++] = next++;
+		}
+
+		if( active_count == 0 ){
+			if( next < band->count ){
+				y = edges[next].y_top - 1;
+			}
+			continue;
+		}
+
+		for(i=1; i < active_count; i++){
+			index = active[i];
+			for(j=i; (j > 0) && (edges[active[j-1]].x > edges[index].x); j--){
+				active[j] = active[j-1];
+			}
+			active[j] = index;
+		}
+
+		//pixels from the crossing of an edge that starts the inside up to the one that ends it
+		span_count = 0;
+		winding = 0;
+		for(i=0; i < active_count; i++){
+			edge = edges + active[i];
+			if( winding == 0 ){
+				left = edge->x;
+			}
+
+			if( is_odd_even ){
+				winding ^= 1;
+			} else {
+				winding += edge->winding;
+			}
+
+			if( winding == 0 ){
+				right = edge->x;
+				if( left < 0 ){ left = 0; }
+				if( right > bmap->area.width ){ right = bmap->area.width; }
+				if( right > left ){
+					spans[span_count].point.x = left;
+					spans[span_count].point.y = y;
+					spans[span_count].area.width = right - left;
+					spans[span_count].area.height = 1;
+					span_count++;
+				}
+			}
+		}
+		sg_draw_row_spans(bmap, y, spans, span_count);
+
+		for(i=0; i < active_count; i++){
+			edge = edges + active[i];
+			edge->x += edge->step_x;
+			edge->remainder -= edge->step_remainder;
+			if( edge->remainder < 0 ){
+				edge->x++;
+				edge->remainder += edge->dy;
+			}
+		}
+	}
+}
+
+/*
+ * Fills the rows of the band with antialiased edges
+ *
+ * Each pixel is blended toward the pen color by the fraction of its area
+ * that is inside the path. The part of each edge that crosses the row
+ * adds its signed height to the cells it passes through. The share of
+ * the height to the right of the edge goes in the edge's cell and the
+ * rest goes in the next cell. A running sum along the row then gives the
+ * winding-weighted area of each pixel. Paths that are wider than the
+ * accumulation row are done in strips.
+ *
+ */
+void draw_coverage_band(const sg_bmap_t * bmap, fill_band_t * band, int is_odd_even){
+	s32 cells[VECTOR_COVERAGE_WIDTH + 1];
+	coverage_edge_t * line;
+	s32 row_first;
+	s32 row_end;
+	s32 strip;
+	s32 width;
+	s32 y;
+	u32 j;
+
+	if( band->count == 0 ){
+		return;
+	}
+
+	if( band->x_min < 0 ){
+		band->x_min = 0;
+	}
+	if( band->x_max >= bmap->area.width ){
+		band->x_max = bmap->area.width - 1;
+	}
+
+	row_first = band->band_end;
+	row_end = band->band_top;
+	for(j=0; j < band->count; j++){
+		if( band->lines[j].y_top < row_first ){ row_first = band->lines[j].y_top; }
+		if( band->lines[j].y_end > row_end ){ row_end = band->lines[j].y_end; }
+	}
+
+	for(y = row_first; y < row_end; y++){
+		for(strip = band->x_min; strip <= band->x_max; strip += VECTOR_COVERAGE_WIDTH){
+			width = band->x_max - strip + 1;
+			if( width > VECTOR_COVERAGE_WIDTH ){
+				width = VECTOR_COVERAGE_WIDTH;
+			}
+			memset(cells, 0, sizeof(cells));
+
+			for(j=0; j < band->count; j++){
+				line = band->lines + j;
+				if( (y < line->y_top) || (y >= line->y_end) ){
+					continue;
+				}
+				add_coverage_row(cells, width, line, y, strip);
+			}
+
+			draw_coverage_cells(bmap, cells, width, strip, y, is_odd_even);
+		}
+	}
+}
+
+/*
+ * Fills a row that crosses more edges than fill_band_t holds
+ *
+ * The row is done in windows of VECTOR_COVERAGE_WIDTH pixels. For each
+ * window, the path is walked again and every edge that crosses the row
+ * is added straight to the window's cells, so nothing needs to be
+ * stored. Edges that are left of the window add their winding (or
+ * coverage) to the first cell and edges right of it are skipped.
+ *
+ */
+void draw_fill_row(const sg_bmap_t * bmap, fill_band_t * band, const sg_vector_path_description_t * description, const sg_vector_path_description_t * end, const sg_vector_map_t * map, int is_odd_even){
+	s32 cells[VECTOR_COVERAGE_WIDTH + 1];
+
+	band->cells = cells;
+	for(band->window_x = 0; band->window_x < bmap->area.width; band->window_x += VECTOR_COVERAGE_WIDTH){
+		band->window_width = bmap->area.width - band->window_x;
+		if( band->window_width > VECTOR_COVERAGE_WIDTH ){
+			band->window_width = VECTOR_COVERAGE_WIDTH;
+		}
+		memset(cells, 0, sizeof(cells));
+		add_fill_edges(band, description, end, map);
 
-	//maps the points to the bmap
-	points[0] = p1;
-	points[1] = p2;
-	points[2] = p3;
-	points[3] = p4;
+		if( band->is_antialiased ){
+			draw_coverage_cells(bmap, cells, band->window_width, band->window_x, band->band_top, is_odd_even);
+		} else {
+			draw_winding_cells(bmap, cells, band->window_width, band->window_x, band->band_top, is_odd_even);
+		}
+	}
+	band->cells = 0;
+}
+
+//fills the pixels of a window whose running sum of winding changes is inside the path
+void draw_winding_cells(const sg_bmap_t * bmap, const s32 * cells, s32 width, s32 x, s32 y, int is_odd_even){
+	sg_region_t spans[VECTOR_COVERAGE_WIDTH/2 + 1];
+	u32 span_count = 0;
+	s32 winding = 0;
+	int is_inside;
+	s32 i;
+
+	for(i=0; i < width; i++){
+		winding += cells[i];
+		is_inside = is_odd_even ? (winding & 1) : (winding != 0);
+		if( is_inside == 0 ){
+			continue;
+		}
+
+		if( (span_count > 0) && (spans[span_count-1].point.x + spans[span_count-1].area.width == x + i) ){
+			spans[span_count-1].area.width++;
+		} else {
+			spans[span_count].point.x = x + i;
+			spans[span_count].point.y = y;
+			spans[span_count].area.width = 1;
+			spans[span_count].area.height = 1;
+			span_count++;
+		}
+	}
+	sg_draw_row_spans(bmap, y, spans, span_count);
+}
 
-	for(i=0; i < 4; i++){
-		sg_point_map(points + i, map);
+//adds the part of line that is inside row y to cells (cells[0] is at pixel strip)
+void add_coverage_row(s32 * cells, s32 width, const coverage_edge_t * line, s32 y, s32 strip){
+	const s32 row_top = y*VECTOR_COVERAGE_ONE;
+	s32 y_top;
+	s32 y_bottom;
+	s32 x_top;
+	s32 x_bottom;
+
+	y_top = line->y0 > row_top ? line->y0 : row_top;
+	y_bottom = line->y1 < row_top + VECTOR_COVERAGE_ONE ? line->y1 : row_top + VECTOR_COVERAGE_ONE;
+	if( y_top >= y_bottom ){
+		return;
 	}
+	x_top = line->x0 + (s32)((s64)(y_top - line->y0) * (line->x1 - line->x0) / (line->y1 - line->y0));
+	x_bottom = line->x0 + (s32)((s64)(y_bottom - line->y0) * (line->x1 - line->x0) / (line->y1 - line->y0));
 
-	sg_draw_cubic_bezier(bmap, points[0], points[1], points[2], points[3], corners);
+	if( line->winding > 0 ){
+		add_coverage_line(cells, width, x_top - strip*VECTOR_COVERAGE_ONE, y_top, x_bottom - strip*VECTOR_COVERAGE_ONE, y_bottom);
+	} else {
+		add_coverage_line(cells, width, x_bottom - strip*VECTOR_COVERAGE_ONE, y_bottom, x_top - strip*VECTOR_COVERAGE_ONE, y_top);
+	}
+}
 
-	if( region ){
-		update_bounds(corners[0], corners[1], region);
+//converts the summed cells to coverage and blends them on row y starting at pixel strip
+void draw_coverage_cells(const sg_bmap_t * bmap, const s32 * cells, s32 width, s32 strip, s32 y, int is_odd_even){
+	//the sums are in units of 1/2 of VECTOR_COVERAGE_ONE squared
+	const s32 full = 2 << (2*VECTOR_COVERAGE_BITS);
+	u16 coverage[VECTOR_COVERAGE_WIDTH];
+	s32 sum = 0;
+	s32 value;
+	s32 i;
+
+	for(i=0; i < width; i++){
+		sum += cells[i];
+		value = sum < 0 ? -sum : sum;
+		if( is_odd_even ){
+			//areas with an even winding number fold back to zero
+			value %= 2*full;
+			if( value > full ){
+				value = 2*full - value;
+			}
+		} else if( value > full ){
+			value = full;
+		}
+		coverage[i] = value >> (VECTOR_COVERAGE_BITS + 1);
 	}
+	sg_draw_coverage_row(bmap, strip, y, coverage, width);
 }
 
+/*
+ * Adds the coverage of a line from (x0, y0) to (x1, y1) within one row
+ *
+ * x is relative to the start of cells and the line is split where it
+ * crosses the edge of a pixel. Parts that are left of the cells
+ * cover every cell so they are added to the first one. Parts right of the
+ * cells don't affect them. Every split is interpolated from the end points
+ * so where the cells start doesn't change the result.
+ *
+ */
+void add_coverage_line(s32 * cells, s32 width, s32 x0, s32 y0, s32 x1, s32 y1){
+	const s32 right = width*VECTOR_COVERAGE_ONE;
+	s32 x_first = x0;
+	s32 x_last = x1;
+	s32 y_first = y0;
+	s32 y_last = y1;
+	s32 x;
+	s32 y;
+	s32 y_next;
+	s32 boundary;
+
+	if( y0 == y1 ){
+		return;
+	}
 
+	//clip to the left and right sides of the cells
+	if( (x0 < 0) || (x1 < 0) ){
+		if( (x0 <= 0) && (x1 <= 0) ){
+			cells[0] += (y1 - y0)*2*VECTOR_COVERAGE_ONE;
+			return;
+		}
+		y = y0 + (s32)((s64)(0 - x0) * (y1 - y0) / (x1 - x0));
+		if( x0 < 0 ){
+			cells[0] += (y - y0)*2*VECTOR_COVERAGE_ONE;
+			x_first = 0;
+			y_first = y;
+		} else {
+			cells[0] += (y1 - y)*2*VECTOR_COVERAGE_ONE;
+			x_last = 0;
+			y_last = y;
+		}
+	}
 
+	if( (x0 > right) || (x1 > right) ){
+		if( (x_first >= right) && (x_last >= right) ){
+			return;
+		}
+		y = y0 + (s32)((s64)(right - x0) * (y1 - y0) / (x1 - x0));
+		if( x0 > right ){
+			x_first = right;
+			y_first = y;
+		} else {
+			x_last = right;
+			y_last = y;
+		}
+	}
+
+	//walk the pixels that the line passes through
+	x = x_first;
+	y = y_first;
+	while( x != x_last ){
+		if( x_last > x_first ){
+			boundary = ((x >> VECTOR_COVERAGE_BITS) + 1)*VECTOR_COVERAGE_ONE;
+			if( boundary >= x_last ){ break; }
+		} else {
+			boundary = ((x - 1) >> VECTOR_COVERAGE_BITS)*VECTOR_COVERAGE_ONE;
+			if( boundary <= x_last ){ break; }
+		}
+		y_next = y0 + (s32)((s64)(boundary - x0) * (y1 - y0) / (x1 - x0));
+		add_coverage_cell(cells, width, x, boundary, y_next - y);
+		x = boundary;
+		y = y_next;
+	}
+	add_coverage_cell(cells, width, x, x_last, y_last - y);
+}
 
+//adds the coverage of part of a line that is within one pixel
+void add_coverage_cell(s32 * cells, s32 width, s32 x0, s32 x1, s32 dy){
+	const s32 x = x0 < x1 ? x0 : x1;
+	const s32 cell = x >> VECTOR_COVERAGE_BITS;
+	s32 area;
 
+	if( cell >= width ){
+		return;
+	}
 
+	//twice the part of the pixel to the right of the line (times dy)
+	area = dy * (2*(cell + 1)*VECTOR_COVERAGE_ONE - x0 - x1);
+	cells[cell] += area;
+	cells[cell + 1] += dy*2*VECTOR_COVERAGE_ONE - area;
+}
@@ -0,0 +1,231 @@
+//COPYING: Copyright 2011-2020 Tyler Gilbert and Stratify Labs, Inc; see LICENSE.md for rights.
+
+/*
+ * Checks the word fill kernels against a pixel by pixel reference
+ *
+ * sg_fill_words() uses the SSE2 or AVX2 kernel (when the processor has
+ * one) for runs of SG_FILL_SIMD_MIN_WORDS or more. The kernels share
+ * the and/xor masks that the raster operation is reduced to, so they are
+ * checked against fill_reference(), which looks up each bit of each pixel
+ * in the operation's truth table instead. Each kernel that is compiled in
+ * and that the processor can run is checked (not just the one that
+ * sg_fill_words() selects). Every raster operation is run with several
+ * masks at each alignment and for run lengths on both sides of the 4 and
+ * 8 word vector widths, and the words around the run must not change.
+ *
+ * The pen flags are checked by drawing long rows with
+ * sg_cursor_draw_pattern() and comparing each pixel with what the flag
+ * does to it (assign, OR, XOR, erase or skip zero pixels). In the
+ * variable bits per pixel build, this is done for 1, 2, 4 and 8 bits per
+ * pixel.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sg_config.h"
+#include "sg.h"
+
+#define FILL_TEST_WORDS 48
+#define FILL_TEST_MAX_COUNT 40
+#define FILL_TEST_MAX_OFFSET 8
+
+static u32 random_state = 0x12345678;
+
+static u32 random_word();
+static void fill_reference(sg_bmap_data_t * target, u32 count, sg_bmap_data_t pattern, sg_bmap_data_t mask, u8 rop);
+static u32 calc_pen_pixel(u16 o_flags, u32 pen, u32 dest);
+static int test_rop(u32 kernel, u8 rop);
+static int test_pen_flags(u16 o_flags, u8 bits_per_pixel);
+
+int main(int argc, char * argv[]){
+	const u16 pen_flags[] = {
+		SG_PEN_FLAG_IS_SOLID,
+		SG_PEN_FLAG_IS_BLEND,
+		SG_PEN_FLAG_IS_INVERT,
+		SG_PEN_FLAG_IS_ERASE,
+		SG_PEN_FLAG_IS_ZERO_TRANSPARENT,
+		SG_PEN_FLAG_IS_ZERO_TRANSPARENT | SG_PEN_FLAG_IS_BLEND
+	};
+#if SG_BITS_PER_PIXEL == 0
+	const u8 bits_per_pixel[] = { 1, 2, 4, 8 };
+#else
+	const u8 bits_per_pixel[] = { SG_BITS_PER_PIXEL };
+#endif
+	sg_bmap_data_t word;
+	int failures = 0;
+	u32 kernel;
+	u32 b;
+	u32 i;
+
+	MCU_UNUSED_ARGUMENT(argc);
+	MCU_UNUSED_ARGUMENT(argv);
+
+	for(kernel=0; kernel < SG_FILL_KERNEL_TOTAL; kernel++){
+		if( sg_fill_words_kernel(kernel, &word, 1, 0, 0, SG_ROP_COPY) < 0 ){
+			printf("fill kernel %ld: not available\n", (long)kernel);
+			continue;
+		}
+		for(i=0; i < 16; i++){
+			failures += test_rop(kernel, i);
+		}
+	}
+
+	for(b=0; b < sizeof(bits_per_pixel); b++){
+		for(i=0; i < sizeof(pen_flags)/sizeof(pen_flags[0]); i++){
+			failures += test_pen_flags(pen_flags[i], bits_per_pixel[b]);
+		}
+	}
+
+	if( failures ){
+		printf("sg_fill_words: %d failures\n", failures);
+		return 1;
+	}
+
+	printf("sg_fill_words: passed\n");
+	return 0;
+}
+
+//xorshift so the test is the same on every host
+u32 random_word(){
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+//applies rop to one bit at a time (bit (pattern << 1) | dest of rop is the result)
+void fill_reference(sg_bmap_data_t * target, u32 count, sg_bmap_data_t pattern, sg_bmap_data_t mask, u8 rop){
+	u32 pattern_bit;
+	u32 dest_bit;
+	u32 bit;
+	u32 i;
+
+	for(i=0; i < count; i++){
+		for(bit=0; bit < SG_BITS_PER_WORD; bit++){
+			if( (mask >> bit) & 1 ){
+				pattern_bit = (pattern >> bit) & 1;
+				dest_bit = (target[i] >> bit) & 1;
+				target[i] &= ~((sg_bmap_data_t)1 << bit);
+				target[i] |= (sg_bmap_data_t)((rop >> ((pattern_bit << 1) | dest_bit)) & 1) << bit;
+			}
+		}
+	}
+}
+
+//what a pen with o_flags does to one pixel
+u32 calc_pen_pixel(u16 o_flags, u32 pen, u32 dest){
+	if( (o_flags & SG_PEN_FLAG_IS_ZERO_TRANSPARENT) && (pen == 0) ){
+		return dest;
+	}
+	if( o_flags & SG_PEN_FLAG_IS_ERASE ){
+		return dest & ~pen;
+	}
+	if( o_flags & SG_PEN_FLAG_IS_INVERT ){
+		return dest ^ pen;
+	}
+	if( o_flags & SG_PEN_FLAG_IS_BLEND ){
+		return dest | pen;
+	}
+	return pen;
+}
+
+int test_rop(u32 kernel, u8 rop){
+	sg_bmap_data_t fast[FILL_TEST_WORDS];
+	sg_bmap_data_t selected[FILL_TEST_WORDS];
+	sg_bmap_data_t reference[FILL_TEST_WORDS];
+	sg_bmap_data_t masks[4];
+	sg_bmap_data_t pattern;
+	int failures = 0;
+	u32 offset;
+	u32 count;
+	u32 m;
+	u32 i;
+
+	masks[0] = 0xffffffff;
+	masks[1] = 0x00000000;
+	masks[2] = 0x0f0f0f0f;
+	masks[3] = random_word();
+
+	for(m=0; m < 4; m++){
+		for(offset=0; offset < FILL_TEST_MAX_OFFSET; offset++){
+			for(count=0; count <= FILL_TEST_MAX_COUNT; count++){
+				pattern = random_word();
+				for(i=0; i < FILL_TEST_WORDS; i++){
+					fast[i] = random_word();
+					selected[i] = fast[i];
+					reference[i] = fast[i];
+				}
+
+				sg_fill_words_kernel(kernel, fast + offset, count, pattern, masks[m], rop);
+				sg_fill_words(selected + offset, count, pattern, masks[m], rop);
+				fill_reference(reference + offset, count, pattern, masks[m], rop);
+
+				if( memcmp(fast, reference, sizeof(fast)) ||
+						memcmp(selected, reference, sizeof(selected)) ){
+					printf("kernel %ld rop 0x%X mask 0x%08lX offset %ld count %ld does not match\n",
+							 (long)kernel, rop, (unsigned long)masks[m], (long)offset, (long)count);
+					failures++;
+				}
+			}
+		}
+	}
+
+	return failures;
+}
+
+//draws rows with the pen flags and checks each pixel (the long rows use the vector kernels)
+int test_pen_flags(u16 o_flags, u8 bits_per_pixel){
+	const u32 pixels_per_word = SG_BITS_PER_WORD / bits_per_pixel;
+	const u32 pixel_mask = (1 << bits_per_pixel) - 1;
+	const u32 test_width = FILL_TEST_WORDS * pixels_per_word;
+	sg_bmap_data_t data[FILL_TEST_WORDS];
+	sg_bmap_data_t before[FILL_TEST_WORDS];
+	sg_bmap_data_t pattern;
+	sg_cursor_t cursor;
+	sg_bmap_t bmap;
+	int failures = 0;
+	u32 expected;
+	u32 pixel;
+	u32 start;
+	u32 width;
+	u32 x;
+	u32 i;
+
+	sg_bmap_set_data(&bmap, data, sg_dim(test_width, 1), bits_per_pixel);
+	bmap.pen.color = 1;
+	bmap.pen.o_flags = o_flags;
+
+	for(i=0; i < 200; i++){
+		for(x=0; x < FILL_TEST_WORDS; x++){
+			data[x] = random_word();
+			before[x] = data[x];
+		}
+		//some pixels of the pattern are zero
+		pattern = random_word() & random_word();
+		start = random_word() % test_width;
+		width = random_word() % (test_width - start + 1);
+
+		sg_cursor_set(&cursor, &bmap, sg_point(start, 0));
+		sg_cursor_draw_pattern(&cursor, width, pattern);
+
+		for(x=0; x < test_width; x++){
+			pixel = (before[x / pixels_per_word] >> ((x % pixels_per_word) * bits_per_pixel)) & pixel_mask;
+			expected = pixel;
+			if( (x >= start) && (x < start + width) ){
+				expected = calc_pen_pixel(o_flags,
+						(pattern >> ((x % pixels_per_word) * bits_per_pixel)) & pixel_mask,
+						pixel);
+			}
+			if( sg_get_pixel(&bmap, sg_point(x, 0)) != expected ){
+				printf("%d bpp pen flags 0x%X start %ld width %ld pixel %ld does not match\n",
+						 bits_per_pixel, o_flags, (long)start, (long)width, (long)x);
+				failures++;
+				break;
+			}
+		}
+	}
+
+	return failures;
+}
@@ -0,0 +1,126 @@
+//COPYING: Copyright 2011-2020 Tyler Gilbert and Stratify Labs, Inc; see LICENSE.md for rights.
+
+/*
+ * Times sg_cursor_draw_pattern() against drawing the partial words pixel by pixel
+ *
+ * The pixel by pixel version is how the head and tail of a span used to be
+ * drawn: sg_cursor_draw_pixel() until the cursor is word aligned, the
+ * aligned words in bulk and sg_cursor_draw_pixel() again for the rest.
+ * Spans of each width from 1 to 64 pixels are drawn at every starting
+ * pixel of a word for each pen mode and the average time per span (best
+ * of several rounds so host scheduling noise drops out) is printed. This
+ * is a benchmark, not a test, so it always succeeds.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sg_config.h"
+#include "sg.h"
+
+#define PATTERN_BENCH_WIDTH 256
+#define PATTERN_BENCH_REPEAT 200
+#define PATTERN_BENCH_ROUNDS 9
+
+typedef void (*draw_span_t)(sg_cursor_t * cursor, sg_size_t width);
+
+static sg_bmap_data_t bench_data[PATTERN_BENCH_WIDTH / SG_BYTES_PER_WORD];
+
+static void draw_span_masked(sg_cursor_t * cursor, sg_size_t width);
+static void draw_span_pixels(sg_cursor_t * cursor, sg_size_t width);
+static double time_spans(sg_bmap_t * bmap, sg_size_t width, draw_span_t draw_span);
+
+int main(int argc, char * argv[]){
+	const u8 bits_per_pixel[] = { 1, 8 };
+	const u16 pen_flags[] = {
+		SG_PEN_FLAG_IS_SOLID,
+		SG_PEN_FLAG_IS_BLEND,
+		SG_PEN_FLAG_IS_INVERT,
+		SG_PEN_FLAG_IS_ERASE,
+		SG_PEN_FLAG_IS_ZERO_TRANSPARENT
+	};
+	const sg_size_t widths[] = { 1, 2, 4, 8, 16, 24, 32, 48, 64 };
+	sg_bmap_t bmap;
+	u32 b;
+	u32 f;
+	u32 w;
+
+	MCU_UNUSED_ARGUMENT(argc);
+	MCU_UNUSED_ARGUMENT(argv);
+
+	printf("bpp flags width pixels(ns) masked(ns)\n");
+	for(b=0; b < sizeof(bits_per_pixel); b++){
+		sg_bmap_set_data(&bmap, bench_data, sg_dim(PATTERN_BENCH_WIDTH * 8 / bits_per_pixel[b], 1), bits_per_pixel[b]);
+		bmap.pen.color = 0x5a;
+		for(f=0; f < sizeof(pen_flags)/sizeof(pen_flags[0]); f++){
+			bmap.pen.o_flags = pen_flags[f];
+			for(w=0; w < sizeof(widths)/sizeof(widths[0]); w++){
+				printf("%d 0x%02X %d %.1f %.1f\n",
+						 bits_per_pixel[b], pen_flags[f], widths[w],
+						 time_spans(&bmap, widths[w], draw_span_pixels),
+						 time_spans(&bmap, widths[w], draw_span_masked));
+			}
+		}
+	}
+
+	return 0;
+}
+
+void draw_span_masked(sg_cursor_t * cursor, sg_size_t width){
+	sg_cursor_draw_hline(cursor, width);
+}
+
+void draw_span_pixels(sg_cursor_t * cursor, sg_size_t width){
+	const u32 bits_per_pixel = cursor->bmap->bits_per_pixel;
+	sg_size_t aligned;
+
+	while( width && cursor->shift ){
+		sg_cursor_draw_pixel(cursor);
+		width--;
+	}
+
+	aligned = width - width % (SG_BITS_PER_WORD / bits_per_pixel);
+	if( aligned ){
+		sg_cursor_draw_hline(cursor, aligned);
+		width -= aligned;
+	}
+
+	while( width ){
+		sg_cursor_draw_pixel(cursor);
+		width--;
+	}
+}
+
+//average time to draw one span starting at each pixel of a word (fastest round)
+double time_spans(sg_bmap_t * bmap, sg_size_t width, draw_span_t draw_span){
+	const u32 pixels_per_word = SG_BITS_PER_WORD / bmap->bits_per_pixel;
+	struct timespec start;
+	struct timespec end;
+	sg_cursor_t cursor;
+	double best = 0;
+	double elapsed;
+	u32 round;
+	u32 repeat;
+	u32 x;
+
+	memset(bench_data, 0, sizeof(bench_data));
+	for(round=0; round < PATTERN_BENCH_ROUNDS; round++){
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(repeat=0; repeat < PATTERN_BENCH_REPEAT; repeat++){
+			for(x=0; x < pixels_per_word; x++){
+				sg_cursor_set(&cursor, bmap, sg_point(x, 0));
+				draw_span(&cursor, width);
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		elapsed = (end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec);
+		if( (round == 0) || (elapsed < best) ){
+			best = elapsed;
+		}
+	}
+
+	return best / ((double)PATTERN_BENCH_REPEAT * pixels_per_word);
+}
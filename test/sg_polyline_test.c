@@ -0,0 +1,225 @@
+//COPYING: Copyright 2011-2020 Tyler Gilbert and Stratify Labs, Inc; see LICENSE.md for rights.
+
+/*
+ * Checks that thick polylines draw each pixel once
+ *
+ * Each chain is drawn twice on a cleared bitmap: once with a solid pen
+ * and once with an inverting pen. A pixel that is drawn twice is cleared
+ * again by the inverting pen so the two bitmaps only match if every pixel
+ * of the chain is drawn exactly once. The chains are closed convex shapes
+ * (points at sorted angles on an ellipse) with more points than
+ * draw_thick_polyline() handles in one batch, along with open chains of
+ * random points that cross themselves. Arcs with more points than
+ * sg_polyline_t holds are also drawn through sg_polyline_add() so the
+ * joints where the buffer is flushed are checked. A round cap far off the
+ * bitmap is also checked to leave the rows near it untouched.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sg_config.h"
+#include "sg.h"
+
+#define POLYLINE_TEST_WIDTH 96
+#define POLYLINE_TEST_HEIGHT 80
+#define POLYLINE_TEST_MAX_POINTS 40
+#define POLYLINE_TEST_CASES 1000
+#define POLYLINE_TEST_ARCS 300
+
+static u32 random_state = 0x2468ace1;
+
+//room for up to 8 bits per pixel
+static sg_bmap_data_t solid_data[POLYLINE_TEST_WIDTH*POLYLINE_TEST_HEIGHT/SG_BYTES_PER_WORD];
+static sg_bmap_data_t invert_data[POLYLINE_TEST_WIDTH*POLYLINE_TEST_HEIGHT/SG_BYTES_PER_WORD];
+
+static u32 random_word();
+static u32 create_convex_chain(sg_point_t * points);
+static u32 create_random_chain(sg_point_t * points);
+static int test_chain(const sg_point_t * points, u32 count, sg_size_t thickness, u16 cap_flags);
+static int test_buffered_arc(sg_size_t thickness, u16 cap_flags);
+static void draw_buffered_arc(const sg_bmap_t * bmap, sg_point_t center, sg_size_t radius, s16 start, u32 count, s16 step);
+static int test_far_cap();
+
+int main(int argc, char * argv[]){
+	const u16 cap_flags[] = {
+		0,
+		SG_PEN_FLAG_IS_CAP_ROUND,
+		SG_PEN_FLAG_IS_CAP_SQUARE
+	};
+	sg_point_t points[POLYLINE_TEST_MAX_POINTS + 1];
+	int failures = 0;
+	u32 count;
+	u32 i;
+
+	MCU_UNUSED_ARGUMENT(argc);
+	MCU_UNUSED_ARGUMENT(argv);
+
+	for(i=0; i < POLYLINE_TEST_CASES; i++){
+		if( i & 0x01 ){
+			count = create_random_chain(points);
+		} else {
+			count = create_convex_chain(points);
+		}
+		failures += test_chain(points, count, 2 + random_word() % 8, cap_flags[i % 3]);
+	}
+	for(i=0; i < POLYLINE_TEST_ARCS; i++){
+		failures += test_buffered_arc(2 + random_word() % 7, cap_flags[i % 3]);
+	}
+	failures += test_far_cap();
+
+	if( failures ){
+		printf("sg_draw_polyline: %d failures\n", failures);
+		return 1;
+	}
+
+	printf("sg_draw_polyline: passed\n");
+	return 0;
+}
+
+//xorshift so the test is the same on every host
+u32 random_word(){
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+//closed chain around an ellipse (returns the number of points including the closing point)
+u32 create_convex_chain(sg_point_t * points){
+	s16 angles[POLYLINE_TEST_MAX_POINTS];
+	const u32 count = 9 + random_word() % (POLYLINE_TEST_MAX_POINTS - 9);
+	const sg_int_t x = random_word() % POLYLINE_TEST_WIDTH;
+	const sg_int_t y = random_word() % POLYLINE_TEST_HEIGHT;
+	const sg_size_t rx = 2 + random_word() % (POLYLINE_TEST_WIDTH/2);
+	const sg_size_t ry = 2 + random_word() % (POLYLINE_TEST_HEIGHT/2);
+	s16 angle;
+	u32 i;
+	u32 j;
+
+	for(i=0; i < count; i++){
+		angle = random_word() % SG_TRIG_POINTS;
+		for(j=i; (j > 0) && (angles[j-1] > angle); j--){
+			angles[j] = angles[j-1];
+		}
+		angles[j] = angle;
+	}
+
+	for(i=0; i < count; i++){
+		sg_point_arc(points + i, rx, ry, angles[i]);
+		points[i].x += x;
+		points[i].y += y;
+	}
+	points[count] = points[0];
+	return count + 1;
+}
+
+//open chain of points anywhere on (or just off) the bitmap
+u32 create_random_chain(sg_point_t * points){
+	const u32 count = 9 + random_word() % (POLYLINE_TEST_MAX_POINTS - 9);
+	u32 i;
+
+	for(i=0; i < count; i++){
+		points[i].x = (sg_int_t)(random_word() % (POLYLINE_TEST_WIDTH + 20)) - 10;
+		points[i].y = (sg_int_t)(random_word() % (POLYLINE_TEST_HEIGHT + 20)) - 10;
+	}
+	return count;
+}
+
+int test_chain(const sg_point_t * points, u32 count, sg_size_t thickness, u16 cap_flags){
+	sg_bmap_t solid;
+	sg_bmap_t invert;
+
+	sg_bmap_set_data(&solid, solid_data, sg_dim(POLYLINE_TEST_WIDTH, POLYLINE_TEST_HEIGHT), 1);
+	sg_bmap_set_data(&invert, invert_data, sg_dim(POLYLINE_TEST_WIDTH, POLYLINE_TEST_HEIGHT), 1);
+	memset(solid_data, 0, sizeof(solid_data));
+	memset(invert_data, 0, sizeof(invert_data));
+
+	solid.pen.color = 1;
+	solid.pen.thickness = thickness;
+	solid.pen.o_flags = SG_PEN_FLAG_IS_SOLID | cap_flags;
+	invert.pen = solid.pen;
+	invert.pen.o_flags = SG_PEN_FLAG_IS_INVERT | cap_flags;
+
+	sg_draw_polyline(&solid, points, count);
+	sg_draw_polyline(&invert, points, count);
+
+	if( memcmp(solid_data, invert_data, sizeof(solid_data)) ){
+		printf("%ld points thickness %d caps 0x%X: inverted chain does not match\n",
+				 (long)count, thickness, cap_flags);
+		return 1;
+	}
+	return 0;
+}
+
+//arc through sg_polyline_add() that is longer than the point buffer (doesn't cross itself)
+int test_buffered_arc(sg_size_t thickness, u16 cap_flags){
+	const sg_point_t center = sg_point(POLYLINE_TEST_WIDTH/2 + (sg_int_t)(random_word() % 11) - 5, POLYLINE_TEST_HEIGHT/2 + (sg_int_t)(random_word() % 11) - 5);
+	const sg_size_t radius = thickness + 4 + random_word() % (POLYLINE_TEST_HEIGHT/2 - thickness - 4);
+	//33 to 160 points over at most 3/4 of a turn (steps of a pixel or less on small arcs)
+	const u32 count = 33 + random_word() % 128;
+	const s16 step = 1 + random_word() % (3*SG_TRIG_POINTS/4/count);
+	const s16 start = random_word() % SG_TRIG_POINTS;
+	sg_bmap_t solid;
+	sg_bmap_t invert;
+
+	sg_bmap_set_data(&solid, solid_data, sg_dim(POLYLINE_TEST_WIDTH, POLYLINE_TEST_HEIGHT), 1);
+	sg_bmap_set_data(&invert, invert_data, sg_dim(POLYLINE_TEST_WIDTH, POLYLINE_TEST_HEIGHT), 1);
+	memset(solid_data, 0, sizeof(solid_data));
+	memset(invert_data, 0, sizeof(invert_data));
+
+	solid.pen.color = 1;
+	solid.pen.thickness = thickness;
+	solid.pen.o_flags = SG_PEN_FLAG_IS_SOLID | cap_flags;
+	invert.pen = solid.pen;
+	invert.pen.o_flags = SG_PEN_FLAG_IS_INVERT | cap_flags;
+
+	draw_buffered_arc(&solid, center, radius, start, count, step);
+	draw_buffered_arc(&invert, center, radius, start, count, step);
+
+	if( memcmp(solid_data, invert_data, sizeof(solid_data)) ){
+		printf("buffered arc radius %d %ld points step %d thickness %d caps 0x%X: inverted arc does not match\n",
+				 radius, (long)count, step, thickness, cap_flags);
+		return 1;
+	}
+	return 0;
+}
+
+void draw_buffered_arc(const sg_bmap_t * bmap, sg_point_t center, sg_size_t radius, s16 start, u32 count, s16 step){
+	sg_polyline_t polyline;
+	sg_point_t p;
+	u32 i;
+
+	sg_polyline_start(&polyline, bmap);
+	for(i=0; i < count; i++){
+		sg_point_arc(&p, radius, radius, (start + i*step) % SG_TRIG_POINTS);
+		p.x += center.x;
+		p.y += center.y;
+		sg_polyline_add(&polyline, p);
+	}
+	sg_polyline_finish(&polyline);
+}
+
+//the cap at y = -32768 is far from row 0 (the row offset used to overflow when squared)
+int test_far_cap(){
+	sg_bmap_t bmap;
+	sg_int_t x;
+
+	sg_bmap_set_data(&bmap, solid_data, sg_dim(POLYLINE_TEST_WIDTH, POLYLINE_TEST_HEIGHT), 1);
+	memset(solid_data, 0, sizeof(solid_data));
+
+	bmap.pen.color = 1;
+	bmap.pen.thickness = 3;
+	bmap.pen.o_flags = SG_PEN_FLAG_IS_SOLID | SG_PEN_FLAG_IS_CAP_ROUND;
+	sg_draw_line(&bmap, sg_point(10, -32768), sg_point(80, 40));
+
+	//the line crosses row 0 near x = 79
+	for(x=0; x < 70; x++){
+		if( sg_get_pixel(&bmap, sg_point(x, 0)) ){
+			printf("far round cap: pixel %d,0 is set\n", x);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,290 @@
+//COPYING: Copyright 2011-2020 Tyler Gilbert and Stratify Labs, Inc; see LICENSE.md for rights.
+
+/*
+ * Checks sg_draw_pour() and sg_draw_pour_spans() against a reference fill
+ *
+ * The bitmaps are random noise and random rectangle outlines poured from
+ * a random point within random bounds. The reference is a breadth first
+ * fill that reads one pixel at a time. With a visited mask, every stack
+ * size (down to a single span) must match the reference. Without one,
+ * the pour must stop short only when it reports dropped spans and must
+ * never fill a pixel the reference doesn't.
+ *
+ * Noise needs thousands of spans on a large bitmap. The last check times
+ * a 320x240 noise pour with a 64 span stack (so it rescans) against the
+ * reference fill. The pour has to be faster than the reference, which
+ * only holds if the rescans stay a word at a time.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sg_config.h"
+#include "sg.h"
+
+#define POUR_TEST_WIDTH 96
+#define POUR_TEST_HEIGHT 80
+#define POUR_TEST_CASES 400
+#define POUR_TIMING_WIDTH 320
+#define POUR_TIMING_HEIGHT 240
+#define POUR_TIMING_ROUNDS 5
+
+static u32 random_state = 0x0badcafe;
+
+//room for up to 8 bits per pixel
+static sg_bmap_data_t pour_data[POUR_TIMING_WIDTH*POUR_TIMING_HEIGHT/SG_BYTES_PER_WORD];
+static sg_bmap_data_t reference_data[POUR_TIMING_WIDTH*POUR_TIMING_HEIGHT/SG_BYTES_PER_WORD];
+static sg_bmap_data_t start_data[POUR_TIMING_WIDTH*POUR_TIMING_HEIGHT/SG_BYTES_PER_WORD];
+static sg_point_t reference_queue[POUR_TIMING_WIDTH*POUR_TIMING_HEIGHT];
+static u32 visited[SG_POUR_VISITED_WORDS(POUR_TIMING_WIDTH, POUR_TIMING_HEIGHT)];
+static sg_pour_span_t spans[64];
+
+static u32 random_word();
+static void create_noise(sg_bmap_t * bmap, u32 density);
+static void create_outlines(sg_bmap_t * bmap);
+static void pour_reference(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region);
+static int test_case(u32 i);
+static int compare_pour(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, u32 max_spans, int is_visited);
+static int test_timing();
+static double get_elapsed(const struct timespec * start);
+
+int main(int argc, char * argv[]){
+	int failures = 0;
+	u32 i;
+
+	MCU_UNUSED_ARGUMENT(argc);
+	MCU_UNUSED_ARGUMENT(argv);
+
+	for(i=0; i < POUR_TEST_CASES; i++){
+		failures += test_case(i);
+	}
+	failures += test_timing();
+
+	if( failures ){
+		printf("sg_draw_pour: %d failures\n", failures);
+		return 1;
+	}
+
+	printf("sg_draw_pour: passed\n");
+	return 0;
+}
+
+//xorshift so the test is the same on every host
+u32 random_word(){
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+//sets density percent of the pixels to color one (the outline) and a few to other colors
+void create_noise(sg_bmap_t * bmap, u32 density){
+	sg_point_t p;
+
+	memset(bmap->data, 0, sg_calc_bmap_size(bmap, bmap->area));
+	for(p.y=0; p.y < bmap->area.height; p.y++){
+		for(p.x=0; p.x < bmap->area.width; p.x++){
+			if( random_word() % 100 < density ){
+				bmap->pen.color = (random_word() & 0x07) ? 1 : 2 + random_word() % 2;
+				sg_draw_pixel(bmap, p);
+			}
+		}
+	}
+}
+
+//draws outlines of random rectangles (some overlap and some touch the edges)
+void create_outlines(sg_bmap_t * bmap){
+	const u32 count = 1 + random_word() % 12;
+	sg_region_t region;
+	u32 i;
+
+	memset(bmap->data, 0, sg_calc_bmap_size(bmap, bmap->area));
+	bmap->pen.color = 1;
+	bmap->pen.thickness = 1;
+	for(i=0; i < count; i++){
+		region.point.x = (sg_int_t)(random_word() % (bmap->area.width + 8)) - 4;
+		region.point.y = (sg_int_t)(random_word() % (bmap->area.height + 8)) - 4;
+		region.area = sg_dim(2 + random_word() % bmap->area.width, 2 + random_word() % bmap->area.height);
+		sg_draw_line(bmap, region.point, sg_point(region.point.x + region.area.width, region.point.y));
+		sg_draw_line(bmap, region.point, sg_point(region.point.x, region.point.y + region.area.height));
+		sg_draw_line(bmap, sg_point(region.point.x + region.area.width, region.point.y), sg_point(region.point.x + region.area.width, region.point.y + region.area.height));
+		sg_draw_line(bmap, sg_point(region.point.x, region.point.y + region.area.height), sg_point(region.point.x + region.area.width, region.point.y + region.area.height));
+	}
+}
+
+//breadth first fill one pixel at a time
+void pour_reference(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region){
+	const sg_color_t active_color = bmap->pen.color;
+	const sg_int_t x_min = region->point.x < 0 ? 0 : region->point.x;
+	const sg_int_t y_min = region->point.y < 0 ? 0 : region->point.y;
+	sg_int_t x_max = region->point.x + region->area.width - 1;
+	sg_int_t y_max = region->point.y + region->area.height - 1;
+	sg_point_t next;
+	u32 head = 0;
+	u32 tail = 0;
+	u32 d;
+
+	if( x_max >= bmap->area.width ){ x_max = bmap->area.width - 1; }
+	if( y_max >= bmap->area.height ){ y_max = bmap->area.height - 1; }
+	if( (p.x < x_min) || (p.x > x_max) || (p.y < y_min) || (p.y > y_max) ||
+			(sg_get_pixel(bmap, p) == active_color) ){
+		return;
+	}
+
+	sg_draw_pixel(bmap, p);
+	reference_queue[tail++] = p;
+	while( head < tail ){
+		p = reference_queue[head++];
+		for(d=0; d < 4; d++){
+			next = p;
+			switch(d){
+				case 0: next.x--; break;
+				case 1: next.x++; break;
+				case 2: next.y--; break;
+				default: next.y++; break;
+			}
+			if( (next.x >= x_min) && (next.x <= x_max) && (next.y >= y_min) && (next.y <= y_max) &&
+					(sg_get_pixel(bmap, next) != active_color) ){
+				sg_draw_pixel(bmap, next);
+				reference_queue[tail++] = next;
+			}
+		}
+	}
+}
+
+int test_case(u32 i){
+	const u32 max_spans[] = { 1, 4, 64 };
+	sg_bmap_t bmap;
+	sg_region_t region;
+	sg_point_t p;
+	int failures = 0;
+	u32 j;
+
+	sg_bmap_set_data(&bmap, start_data, sg_dim(POUR_TEST_WIDTH, POUR_TEST_HEIGHT), 2);
+	if( i & 0x01 ){
+		create_noise(&bmap, 5 + random_word() % 35);
+	} else {
+		create_outlines(&bmap);
+	}
+
+	region.point.x = (sg_int_t)(random_word() % 40) - 20;
+	region.point.y = (sg_int_t)(random_word() % 40) - 20;
+	region.area = sg_dim(20 + random_word() % (POUR_TEST_WIDTH + 20), 20 + random_word() % (POUR_TEST_HEIGHT + 20));
+	p.x = random_word() % POUR_TEST_WIDTH;
+	p.y = random_word() % POUR_TEST_HEIGHT;
+	//mostly the outline color so the pour has something to stop at
+	bmap.pen.color = (i & 0x06) ? 1 : random_word() % 4;
+	bmap.pen.o_flags = SG_PEN_FLAG_IS_SOLID;
+
+	for(j=0; j < sizeof(max_spans)/sizeof(max_spans[0]); j++){
+		failures += compare_pour(&bmap, p, &region, max_spans[j], 1);
+		failures += compare_pour(&bmap, p, &region, max_spans[j], 0);
+	}
+	failures += compare_pour(&bmap, p, &region, 0, 1);
+	return failures;
+}
+
+//pours on a copy of bmap (max_spans zero uses sg_draw_pour())
+int compare_pour(const sg_bmap_t * bmap, sg_point_t p, const sg_region_t * region, u32 max_spans, int is_visited){
+	const u32 size = sg_calc_bmap_size(bmap, bmap->area);
+	sg_bmap_t pour;
+	sg_bmap_t reference;
+	sg_point_t q;
+	int dropped = 0;
+
+	sg_bmap_set_data(&pour, pour_data, bmap->area, bmap->bits_per_pixel);
+	sg_bmap_set_data(&reference, reference_data, bmap->area, bmap->bits_per_pixel);
+	pour.pen = bmap->pen;
+	reference.pen = bmap->pen;
+	memcpy(pour_data, bmap->data, size);
+	memcpy(reference_data, bmap->data, size);
+
+	pour_reference(&reference, p, region);
+	if( max_spans == 0 ){
+		sg_draw_pour(&pour, p, region);
+	} else {
+		dropped = sg_draw_pour_spans(&pour, p, region, spans, max_spans, is_visited ? visited : 0);
+	}
+
+	if( dropped == 0 ){
+		if( memcmp(pour_data, reference_data, size) ){
+			printf("%ld spans visited %d: pour does not match the reference\n", (long)max_spans, is_visited);
+			return 1;
+		}
+		return 0;
+	}
+
+	if( is_visited ){
+		printf("%ld spans: pour with a visited mask dropped %d spans\n", (long)max_spans, dropped);
+		return 1;
+	}
+
+	//every pixel the pour changed must be one the reference changed
+	for(q.y=0; q.y < bmap->area.height; q.y++){
+		for(q.x=0; q.x < bmap->area.width; q.x++){
+			if( (sg_get_pixel(&pour, q) != sg_get_pixel(bmap, q)) &&
+					(sg_get_pixel(&pour, q) != sg_get_pixel(&reference, q)) ){
+				printf("%ld spans: partial pour leaked past the outline\n", (long)max_spans);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+int test_timing(){
+	sg_bmap_t bmap;
+	sg_region_t region;
+	struct timespec start;
+	double pour_time = 0;
+	double reference_time = 0;
+	double elapsed;
+	u32 round;
+	int dropped;
+
+	sg_bmap_set_data(&bmap, start_data, sg_dim(POUR_TIMING_WIDTH, POUR_TIMING_HEIGHT), 8);
+	create_noise(&bmap, 20);
+	if( sg_get_pixel(&bmap, sg_point(0, 0)) == 1 ){
+		bmap.pen.color = 0;
+		sg_draw_pixel(&bmap, sg_point(0, 0));
+	}
+	region.point = sg_point(0, 0);
+	region.area = bmap.area;
+	bmap.pen.color = 1;
+	bmap.pen.o_flags = SG_PEN_FLAG_IS_SOLID;
+
+	for(round=0; round < POUR_TIMING_ROUNDS; round++){
+		sg_bmap_set_data(&bmap, pour_data, sg_dim(POUR_TIMING_WIDTH, POUR_TIMING_HEIGHT), 8);
+		memcpy(pour_data, start_data, sizeof(pour_data));
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		dropped = sg_draw_pour_spans(&bmap, sg_point(0, 0), &region, spans, 64, visited);
+		elapsed = get_elapsed(&start);
+		if( (round == 0) || (elapsed < pour_time) ){ pour_time = elapsed; }
+
+		sg_bmap_set_data(&bmap, reference_data, sg_dim(POUR_TIMING_WIDTH, POUR_TIMING_HEIGHT), 8);
+		memcpy(reference_data, start_data, sizeof(reference_data));
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		pour_reference(&bmap, sg_point(0, 0), &region);
+		elapsed = get_elapsed(&start);
+		if( (round == 0) || (elapsed < reference_time) ){ reference_time = elapsed; }
+	}
+
+	if( dropped || memcmp(pour_data, reference_data, sizeof(pour_data)) ){
+		printf("noise: pour does not match the reference\n");
+		return 1;
+	}
+
+	if( pour_time > reference_time ){
+		printf("noise: pour took %.2f ms (reference %.2f ms)\n", pour_time * 1e3, reference_time * 1e3);
+		return 1;
+	}
+	return 0;
+}
+
+double get_elapsed(const struct timespec * start){
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) * 1e-9;
+}
@@ -0,0 +1,123 @@
+//COPYING: Copyright 2011-2020 Tyler Gilbert and Stratify Labs, Inc; see LICENSE.md for rights.
+
+/*
+ * Checks that sg_draw_rectangles() draws each pixel once
+ *
+ * Each list is drawn three times on cleared bitmaps: with sg_draw_rectangle()
+ * for each region and a solid pen, with sg_draw_rectangles() and a solid
+ * pen and with sg_draw_rectangles() and an inverting pen. The first two
+ * must cover the same pixels and the inverted bitmap only matches if no
+ * pixel is drawn twice. Lists are longer than a row of spans that
+ * sg_draw_rectangles() merges at a time and some are narrow strips so
+ * rows have more separate spans than fit at once.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sg_config.h"
+#include "sg.h"
+
+#define RECTANGLES_TEST_WIDTH 160
+#define RECTANGLES_TEST_HEIGHT 64
+#define RECTANGLES_TEST_MAX_REGIONS 300
+#define RECTANGLES_TEST_CASES 500
+
+static u32 random_state = 0x13579bdf;
+
+//room for up to 8 bits per pixel
+static sg_bmap_data_t single_data[RECTANGLES_TEST_WIDTH*RECTANGLES_TEST_HEIGHT/SG_BYTES_PER_WORD];
+static sg_bmap_data_t solid_data[RECTANGLES_TEST_WIDTH*RECTANGLES_TEST_HEIGHT/SG_BYTES_PER_WORD];
+static sg_bmap_data_t invert_data[RECTANGLES_TEST_WIDTH*RECTANGLES_TEST_HEIGHT/SG_BYTES_PER_WORD];
+
+static u32 random_word();
+static u32 create_regions(sg_region_t * regions, int is_strips);
+static int test_regions(const sg_region_t * regions, u32 count);
+
+int main(int argc, char * argv[]){
+	sg_region_t regions[RECTANGLES_TEST_MAX_REGIONS];
+	int failures = 0;
+	u32 count;
+	u32 i;
+
+	MCU_UNUSED_ARGUMENT(argc);
+	MCU_UNUSED_ARGUMENT(argv);
+
+	for(i=0; i < RECTANGLES_TEST_CASES; i++){
+		count = create_regions(regions, i & 0x01);
+		failures += test_regions(regions, count);
+	}
+
+	if( failures ){
+		printf("sg_draw_rectangles: %d failures\n", failures);
+		return 1;
+	}
+
+	printf("sg_draw_rectangles: passed\n");
+	return 0;
+}
+
+//xorshift so the test is the same on every host
+u32 random_word(){
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+//rectangles anywhere on (or just off) the bitmap or narrow strips that rarely touch
+u32 create_regions(sg_region_t * regions, int is_strips){
+	const u32 count = 1 + random_word() % RECTANGLES_TEST_MAX_REGIONS;
+	u32 i;
+
+	for(i=0; i < count; i++){
+		if( is_strips ){
+			regions[i].point.x = 2*(random_word() % (RECTANGLES_TEST_WIDTH/2));
+			regions[i].point.y = random_word() % RECTANGLES_TEST_HEIGHT;
+			regions[i].area = sg_dim(1, 1 + random_word() % RECTANGLES_TEST_HEIGHT);
+		} else {
+			regions[i].point.x = (sg_int_t)(random_word() % (RECTANGLES_TEST_WIDTH + 20)) - 10;
+			regions[i].point.y = (sg_int_t)(random_word() % (RECTANGLES_TEST_HEIGHT + 20)) - 10;
+			regions[i].area = sg_dim(random_word() % 40, random_word() % 20);
+		}
+	}
+	return count;
+}
+
+int test_regions(const sg_region_t * regions, u32 count){
+	sg_bmap_t single;
+	sg_bmap_t solid;
+	sg_bmap_t invert;
+	u32 i;
+
+	sg_bmap_set_data(&single, single_data, sg_dim(RECTANGLES_TEST_WIDTH, RECTANGLES_TEST_HEIGHT), 1);
+	sg_bmap_set_data(&solid, solid_data, sg_dim(RECTANGLES_TEST_WIDTH, RECTANGLES_TEST_HEIGHT), 1);
+	sg_bmap_set_data(&invert, invert_data, sg_dim(RECTANGLES_TEST_WIDTH, RECTANGLES_TEST_HEIGHT), 1);
+	memset(single_data, 0, sizeof(single_data));
+	memset(solid_data, 0, sizeof(solid_data));
+	memset(invert_data, 0, sizeof(invert_data));
+
+	single.pen.color = 1;
+	single.pen.o_flags = SG_PEN_FLAG_IS_SOLID;
+	solid.pen = single.pen;
+	invert.pen = single.pen;
+	invert.pen.o_flags = SG_PEN_FLAG_IS_INVERT;
+
+	for(i=0; i < count; i++){
+		sg_draw_rectangle(&single, regions + i);
+	}
+	sg_draw_rectangles(&solid, regions, count);
+	sg_draw_rectangles(&invert, regions, count);
+
+	if( memcmp(single_data, solid_data, sizeof(single_data)) ){
+		printf("%ld regions: merged rectangles do not match\n", (long)count);
+		return 1;
+	}
+
+	if( memcmp(solid_data, invert_data, sizeof(solid_data)) ){
+		printf("%ld regions: inverted rectangles do not match\n", (long)count);
+		return 1;
+	}
+	return 0;
+}